@@ -12,4 +12,8 @@ Id Recognize(QStringView text) {
 	return {};
 }
 
+std::vector<LanguageId> Recognize(const std::vector<QStringView> &texts) {
+	return std::vector<LanguageId>(texts.size());
+}
+
 } // namespace Platform::Language
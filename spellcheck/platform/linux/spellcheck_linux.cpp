@@ -10,7 +10,9 @@
 #include "spellcheck/platform/linux/linux_enchant.h"
 
 #include "spellcheck/platform/linux/spellcheck_linux.h"
+#include "spellcheck/spellcheck_stats.h"
 #include "base/debug_log.h"
+#include "base/flat_map.h"
 
 namespace Platform::Spellchecker {
 namespace {
@@ -24,6 +26,7 @@ constexpr auto kMaxMySpellCount = 3;
 constexpr auto kMaxWordLength = 15;
 
 using DictPtr = std::unique_ptr<enchant::Dict>;
+using Dicts = std::vector<not_null<enchant::Dict*>>;
 
 auto CheckProvider(DictPtr &validator, const std::string &provider) {
 	auto p = validator->get_provider_name();
@@ -31,16 +34,12 @@ auto CheckProvider(DictPtr &validator, const std::string &provider) {
 	return (p.find(provider) == 0); // startsWith.
 }
 
-auto IsHebrew(const QString &word) {
-	// Words with mixed scripts will be automatically ignored,
-	// so this check should be fine.
-	return ::Spellchecker::WordScript(word) == QChar::Script_Hebrew;
-}
-
 class EnchantSpellChecker {
 public:
 	auto knownLanguages();
 	bool checkSpelling(const QString &word);
+	std::vector<bool> checkSpellingWords(
+		const std::vector<QStringView> &words);
 	auto findSuggestions(const QString &word);
 	void addWord(const QString &wordToAdd);
 	void ignoreWord(const QString &word);
@@ -49,14 +48,28 @@ public:
 	static EnchantSpellChecker *instance();
 
 private:
+	struct Route {
+		Dicts check;
+		Dicts suggest;
+	};
+
 	EnchantSpellChecker();
 	EnchantSpellChecker(const EnchantSpellChecker&) = delete;
 	EnchantSpellChecker& operator =(const EnchantSpellChecker&) = delete;
 
+	void buildRoutes();
+	[[nodiscard]] const Route &route(QChar::Script script) const;
+
 	std::unique_ptr<enchant::Broker> _brokerHandle;
 	std::vector<DictPtr> _validators;
 
 	std::vector<not_null<enchant::Dict*>> _hspells;
+
+	// The dictionaries for the words of each script, in the order
+	// of the validators. It is built once when the dictionaries load.
+	base::flat_map<QChar::Script, Route> _routes;
+	// For the scripts that have no dictionaries of their own.
+	Route _unknownRoute;
 };
 
 EnchantSpellChecker::EnchantSpellChecker() {
@@ -107,6 +120,75 @@ EnchantSpellChecker::EnchantSpellChecker() {
 			DEBUG_LOG(("Catch after request_dict: %1").arg(e.what()));
 		}
 	}
+	buildRoutes();
+}
+
+void EnchantSpellChecker::buildRoutes() {
+	const auto isHspell = [&](not_null<enchant::Dict*> validator) {
+		return ranges::contains(_hspells, validator);
+	};
+	const auto scriptOf = [](not_null<enchant::Dict*> validator) {
+		const auto lang = QString::fromStdString(validator->get_lang());
+		const auto script = ::Spellchecker::LocaleToScriptCode(lang);
+
+		// The locales missing from the table are reported as common.
+		return (script == QChar::Script_Common)
+			? QChar::Script_Unknown
+			: script;
+	};
+	for (const auto &validator : _validators) {
+		const auto script = scriptOf(validator.get());
+		if (script != QChar::Script_Unknown) {
+			_routes.emplace(script, Route());
+		}
+	}
+	for (const auto &pointer : _validators) {
+		const auto validator = not_null<enchant::Dict*>(pointer.get());
+		const auto script = scriptOf(validator);
+
+		// The dictionaries of an unknown script are used for any word.
+		const auto add = [&](auto method) {
+			if (script == QChar::Script_Unknown) {
+				(_unknownRoute.*method).push_back(validator);
+				for (auto &[_, route] : _routes) {
+					(route.*method).push_back(validator);
+				}
+			} else {
+				(_routes[script].*method).push_back(validator);
+			}
+		};
+		add(&Route::suggest);
+
+		// Hspell is the spell checker that only checks words in Hebrew.
+		// It returns 'true' for any non-Hebrew word,
+		// so it is used only for the Hebrew words.
+		if (!isHspell(validator)
+			&& (validator->get_lang().find("uk") != 0)) {
+			add(&Route::check);
+		}
+	}
+	if (!_hspells.empty()) {
+		if (_routes.find(QChar::Script_Hebrew) == end(_routes)) {
+			_routes.emplace(QChar::Script_Hebrew, _unknownRoute);
+		}
+		auto &hebrew = _routes[QChar::Script_Hebrew];
+		hebrew.check = _hspells;
+
+		// Hspell suggestions go first for the Hebrew words.
+		auto suggest = _hspells;
+		for (const auto &validator : hebrew.suggest) {
+			if (!isHspell(validator)) {
+				suggest.push_back(validator);
+			}
+		}
+		hebrew.suggest = std::move(suggest);
+	}
+}
+
+auto EnchantSpellChecker::route(QChar::Script script) const
+-> const Route & {
+	const auto i = _routes.find(script);
+	return (i != end(_routes)) ? i->second : _unknownRoute;
 }
 
 EnchantSpellChecker *EnchantSpellChecker::instance() {
@@ -121,36 +203,47 @@ auto EnchantSpellChecker::knownLanguages() {
 }
 
 bool EnchantSpellChecker::checkSpelling(const QString &word) {
-	auto w = word.toStdString();
+	return checkSpellingWords({ QStringView(word) }).front();
+}
 
-	const auto checkWord = [&](const auto &validator, auto w) {
+std::vector<bool> EnchantSpellChecker::checkSpellingWords(
+		const std::vector<QStringView> &words) {
+	auto result = std::vector<bool>(words.size(), true);
+	::Spellchecker::Count(
+		::Spellchecker::Counter::SystemWords,
+		int64(words.size()));
+	if (_validators.empty()) {
+		return result;
+	}
+	// The buffer is reused for all the words.
+	auto w = std::string();
+
+	const auto checkWord = [&](const auto &validator, QStringView word) {
 		try {
 			return validator->check(w);
 		} catch (const enchant::Exception &e) {
-			DEBUG_LOG(("Catch after check '%1': %2").arg(word, e.what()));
+			DEBUG_LOG(("Catch after check '%1': %2"
+				).arg(word.toString(), e.what()));
 			return true;
 		}
 	};
+	for (auto i = 0; i != words.size(); ++i) {
+		const auto &word = words[i];
+		const auto &validators = route(
+			::Spellchecker::WordScript(word)).check;
+		if (validators.empty()) {
+			result[i] = false;
+			continue;
+		}
+		w.clear();
+		::Spellchecker::AppendUtf8(w, word);
 
-	if (IsHebrew(word) && _hspells.size()) {
-		return ranges::any_of(_hspells, [&](const auto &validator) {
-			return checkWord(validator, w);
+		// Stops at the first validator that knows the word.
+		result[i] = ranges::any_of(validators, [&](const auto &validator) {
+			return checkWord(validator, word);
 		});
 	}
-	return ranges::any_of(_validators, [&](const auto &validator) {
-		// Hspell is the spell checker that only checks words in Hebrew.
-		// It returns 'true' for any non-Hebrew word,
-		// so we should skip Hspell if a word is not in Hebrew.
-		if (ranges::any_of(_hspells, [&](auto &v) {
-				return v == validator.get();
-			})) {
-			return false;
-		}
-		if (validator->get_lang().find("uk") == 0) {
-			return false;
-		}
-		return checkWord(validator, w);
-	}) || _validators.empty();
+	return result;
 }
 
 auto EnchantSpellChecker::findSuggestions(const QString &word) {
@@ -172,29 +265,17 @@ auto EnchantSpellChecker::findSuggestions(const QString &word) {
 		}
 	};
 
+	const auto &validators = route(wordScript).suggest;
 	if (word.size() >= kMaxWordLength) {
 		// The first element is the validator of the system language.
 		auto *v = _validators[0].get();
-		const auto lang = QString::fromStdString(v->get_lang());
-		if (wordScript == ::Spellchecker::LocaleToScriptCode(lang)) {
+		if (ranges::contains(validators, not_null<enchant::Dict*>(v))) {
 			convertSuggestions(v->suggest(w));
 		}
 		return result;
 	}
 
-	if (IsHebrew(word) && _hspells.size()) {
-		for (const auto &h : _hspells) {
-			convertSuggestions(h->suggest(w));
-			if (result.size()) {
-				return result;
-			}
-		}
-	}
-	for (const auto &validator : _validators) {
-		const auto lang = QString::fromStdString(validator->get_lang());
-		if (wordScript != ::Spellchecker::LocaleToScriptCode(lang)) {
-			continue;
-		}
+	for (const auto &validator : validators) {
 		convertSuggestions(validator->suggest(w));
 		if (!result.empty()) {
 			break;
@@ -252,12 +333,30 @@ bool CheckSpelling(const QString &wordToCheck) {
 	return EnchantSpellChecker::instance()->checkSpelling(wordToCheck);
 }
 
+std::vector<bool> CheckSpellingWords(const std::vector<QStringView> &words) {
+	return EnchantSpellChecker::instance()->checkSpellingWords(words);
+}
+
 void FillSuggestionList(
 		const QString &wrongWord,
 		std::vector<QString> *variants) {
 	*variants = EnchantSpellChecker::instance()->findSuggestions(wrongWord);
 }
 
+void FillSuggestionListByParts(
+		const QString &wrongWord,
+		Fn<bool(std::vector<QString> &&part)> callback) {
+	auto variants = std::vector<QString>();
+	FillSuggestionList(wrongWord, &variants);
+	if (!variants.empty()) {
+		callback(std::move(variants));
+	}
+}
+
+// The system spellchecker suggests fast enough without it.
+void PrefetchSuggestions(std::vector<QString> words) {
+}
+
 void AddWord(const QString &word) {
 	EnchantSpellChecker::instance()->addWord(word);
 }
@@ -277,9 +376,9 @@ bool IsWordInDictionary(const QString &wordToCheck) {
 void CheckSpellingText(
 		const QString &text,
 		MisspelledWords *misspelledWords) {
-	*misspelledWords = ::Spellchecker::RangesFromText(
+	*misspelledWords = ::Spellchecker::CheckSkipAndSpellWords(
 		text,
-		::Spellchecker::CheckSkipAndSpell);
+		CheckSpellingWords);
 }
 
 bool IsSystemSpellchecker() {
@@ -40,4 +40,12 @@ LanguageId Recognize(QStringView text) {
 	return {};
 }
 
+std::vector<LanguageId> Recognize(const std::vector<QStringView> &texts) {
+	return ranges::views::all(
+		texts
+	) | ranges::views::transform([](QStringView text) {
+		return Recognize(text);
+	}) | ranges::to_vector;
+}
+
 } // namespace Platform::Language
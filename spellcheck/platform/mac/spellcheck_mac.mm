@@ -6,6 +6,8 @@
 //
 #include "spellcheck/platform/mac/spellcheck_mac.h"
 
+#include "spellcheck/spellcheck_cache.h"
+#include "spellcheck/spellcheck_stats.h"
 #include "base/platform/mac/base_utilities_mac.h"
 
 #import <AppKit/NSSpellChecker.h>
@@ -18,6 +20,8 @@ using Platform::NS2QString;
 
 namespace {
 
+constexpr auto kMaxCachedVerdicts = 8192;
+
 // +[NSSpellChecker sharedSpellChecker] can throw exceptions depending
 // on the state of the pasteboard, or possibly as a result of
 // third-party code (when setting up services entries).  The following
@@ -32,6 +36,11 @@ NSSpellChecker *SharedSpellChecker() {
 	}
 }
 
+::Spellchecker::VerdictCache &Verdicts() {
+	static auto result = ::Spellchecker::VerdictCache(kMaxCachedVerdicts);
+	return result;
+}
+
 inline auto SystemLanguages() {
 	static auto languages = std::vector<QString>();
 	if (!languages.size()) {
@@ -57,19 +66,38 @@ std::vector<QString> ActiveLanguages() {
 }
 
 bool CheckSpelling(const QString &wordToCheck) {
-	const auto wordLength = wordToCheck.length();
-	NSArray<NSTextCheckingResult*> *spellRanges =
-		[SharedSpellChecker()
-			checkString:Q2NSString(std::move(wordToCheck))
-			range:NSMakeRange(0, wordLength)
-			types:NSTextCheckingTypeSpelling
-			options:nil
-			inSpellDocumentWithTag:0
-			orthography:nil
-			wordCount:nil];
-	// If the length of the misspelled word == 0,
-	// then there is no misspelled word.
-	return (spellRanges.count == 0);
+	return CheckSpellingWords({ QStringView(wordToCheck) }).front();
+}
+
+std::vector<bool> CheckSpellingWords(const std::vector<QStringView> &words) {
+	auto &verdicts = Verdicts();
+	const auto epoch = verdicts.epoch();
+	::Spellchecker::Count(
+		::Spellchecker::Counter::SystemWords,
+		int64(words.size()));
+	auto result = std::vector<bool>(words.size(), false);
+	const auto checker = SharedSpellChecker();
+	for (auto i = 0; i != words.size(); ++i) {
+		const auto &word = words[i];
+		if (const auto verdict = verdicts.find(word)) {
+			result[i] = *verdict;
+			continue;
+		}
+		NSArray<NSTextCheckingResult*> *spellRanges =
+			[checker
+				checkString:Q2NSString(word.toString())
+				range:NSMakeRange(0, word.size())
+				types:NSTextCheckingTypeSpelling
+				options:nil
+				inSpellDocumentWithTag:0
+				orthography:nil
+				wordCount:nil];
+		// If the length of the misspelled word == 0,
+		// then there is no misspelled word.
+		result[i] = (spellRanges.count == 0);
+		verdicts.store(word, result[i], epoch);
+	}
+	return result;
 }
 
 
@@ -107,9 +135,9 @@ void CheckSpellingText(
 // But at the same time "testtttyy" will be marked as misspelled word.
 
 // So we have to manually split the text into words and check them separately.
-	*misspelledWords = ::Spellchecker::RangesFromText(
+	*misspelledWords = ::Spellchecker::CheckSkipAndSpellWords(
 		text,
-		::Spellchecker::CheckSkipAndSpell);
+		CheckSpellingWords);
 
 #endif
 }
@@ -145,17 +173,34 @@ void FillSuggestionList(
 	}
 }
 
+void FillSuggestionListByParts(
+		const QString &wrongWord,
+		Fn<bool(std::vector<QString> &&part)> callback) {
+	auto variants = std::vector<QString>();
+	FillSuggestionList(wrongWord, &variants);
+	if (!variants.empty()) {
+		callback(std::move(variants));
+	}
+}
+
+// The system spellchecker suggests fast enough without it.
+void PrefetchSuggestions(std::vector<QString> words) {
+}
+
 void AddWord(const QString &word) {
 	[SharedSpellChecker() learnWord:Q2NSString(word)];
+	Verdicts().invalidate();
 }
 
 void RemoveWord(const QString &word) {
 	[SharedSpellChecker() unlearnWord:Q2NSString(word)];
+	Verdicts().invalidate();
 }
 
 void IgnoreWord(const QString &word) {
 	[SharedSpellChecker() ignoreWord:Q2NSString(word)
 		inSpellDocumentWithTag:0];
+	Verdicts().invalidate();
 }
 
 bool IsWordInDictionary(const QString &wordToCheck) {
@@ -167,6 +212,7 @@ bool IsSystemSpellchecker() {
 }
 
 void UpdateLanguages(std::vector<int> languages) {
+	Verdicts().invalidate();
 	::Spellchecker::UpdateSupportedScripts(SystemLanguages());
 }
 
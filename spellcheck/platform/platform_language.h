@@ -12,4 +12,8 @@ namespace Platform::Language {
 
 [[nodiscard]] LanguageId Recognize(QStringView text);
 
+// Recognizes the languages of many texts at once, sharing the setup.
+[[nodiscard]] std::vector<LanguageId> Recognize(
+	const std::vector<QStringView> &texts);
+
 } // namespace Platform::Language
@@ -15,6 +15,9 @@ constexpr auto kMaxSuggestions = 5;
 
 [[nodiscard]] bool IsSystemSpellchecker();
 [[nodiscard]] bool CheckSpelling(const QString &wordToCheck);
+// Returns a verdict for each word, true means the word is correct.
+[[nodiscard]] std::vector<bool> CheckSpellingWords(
+	const std::vector<QStringView> &words);
 [[nodiscard]] bool IsWordInDictionary(const QString &wordToCheck);
 
 void Init();
@@ -22,6 +25,14 @@ std::vector<QString> ActiveLanguages();
 void FillSuggestionList(
 	const QString &wrongWord,
 	std::vector<QString> *optionalSuggestions);
+// Passes the suggestions by parts, as soon as each part is found.
+// The filling stops when the callback returns false.
+// The callback may be called from different threads, but never at once.
+void FillSuggestionListByParts(
+	const QString &wrongWord,
+	Fn<bool(std::vector<QString> &&part)> callback);
+// Hints that the suggestions for the misspelled words may be asked soon.
+void PrefetchSuggestions(std::vector<QString> words);
 
 void AddWord(const QString &word);
 void RemoveWord(const QString &word);
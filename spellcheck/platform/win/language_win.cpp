@@ -140,4 +140,15 @@ Id Recognize(QStringView text) {
 	return {};
 }
 
+std::vector<LanguageId> Recognize(const std::vector<QStringView> &texts) {
+	if (!Supported()) {
+		return std::vector<LanguageId>(texts.size());
+	}
+	return ranges::views::all(
+		texts
+	) | ranges::views::transform([](QStringView text) {
+		return Recognize(text);
+	}) | ranges::to_vector;
+}
+
 } // namespace Platform::Language
@@ -8,6 +8,7 @@
 
 #include "base/platform/base_platform_info.h"
 #include "spellcheck/third_party/hunspell_controller.h"
+#include "spellcheck/spellcheck_stats.h"
 
 #include <wrl/client.h>
 #include <spellcheck.h>
@@ -16,6 +17,12 @@
 #include <QtCore/QLocale>
 #include <QVector>
 
+#include <condition_variable>
+#include <deque>
+#include <latch>
+#include <mutex>
+#include <thread>
+
 using namespace Microsoft::WRL;
 
 namespace Platform::Spellchecker {
@@ -44,10 +51,212 @@ constexpr auto kChunk = 5000;
 	return list | ranges::to_vector;
 }
 
-// WindowsSpellChecker class is used to store all the COM objects and
-// control their lifetime. The class also provides wrappers for
-// ISpellCheckerFactory and ISpellChecker APIs. All COM calls are on the
-// background thread.
+[[nodiscard]] ComPtr<ISpellChecker> CreateSpellChecker(
+		const QString &langTag) {
+	auto factory = ComPtr<ISpellCheckerFactory>();
+	if (FAILED(CoCreateInstance(
+		__uuidof(SpellCheckerFactory),
+		nullptr,
+		(CLSCTX_INPROC_SERVER | CLSCTX_LOCAL_SERVER),
+		IID_PPV_ARGS(&factory)))) {
+		return nullptr;
+	}
+	const auto wlang = Q2WString(langTag);
+	auto isSupported = (BOOL)false;
+	auto hr = factory->IsSupported(wlang, &isSupported);
+	if (!(SUCCEEDED(hr) && isSupported)) {
+		return nullptr;
+	}
+	auto spellchecker = ComPtr<ISpellChecker>();
+	hr = factory->CreateSpellChecker(wlang, &spellchecker);
+	return SUCCEEDED(hr) ? spellchecker : nullptr;
+}
+
+// Returns nothing if the spellchecker failed to check the text.
+[[nodiscard]] std::optional<MisspelledWords> CheckWith(
+		const QString &langTag,
+		not_null<ISpellChecker*> spellchecker,
+		LPCWSTR text,
+		int offset) {
+	constexpr auto isActionGood = [](auto action) {
+		return action == CORRECTIVE_ACTION_GET_SUGGESTIONS
+			|| action == CORRECTIVE_ACTION_REPLACE;
+	};
+
+	auto spellingErrors = ComPtr<IEnumSpellingError>();
+	auto hr = IsPersianLanguage(langTag)
+		? spellchecker->Check(text, &spellingErrors)
+		: spellchecker->ComprehensiveCheck(text, &spellingErrors);
+	if (!(SUCCEEDED(hr) && spellingErrors)) {
+		return std::nullopt;
+	}
+
+	auto result = MisspelledWords();
+	auto spellingError = ComPtr<ISpellingError>();
+	for (; hr == S_OK; hr = spellingErrors->Next(&spellingError)) {
+		auto startIndex = ULONG(0);
+		auto errorLength = ULONG(0);
+		auto action = CORRECTIVE_ACTION_NONE;
+
+		if (!(SUCCEEDED(hr)
+			&& spellingError
+			&& SUCCEEDED(spellingError->get_StartIndex(&startIndex))
+			&& SUCCEEDED(spellingError->get_Length(&errorLength))
+			&& SUCCEEDED(spellingError->get_CorrectiveAction(&action))
+			&& isActionGood(action))) {
+			continue;
+		}
+		result.push_back({ (int)startIndex + offset, (int)errorLength });
+	}
+	return result;
+}
+
+[[nodiscard]] bool IsWordCorrect(
+		not_null<ISpellChecker*> spellchecker,
+		LPCWSTR word) {
+	auto spellingErrors = ComPtr<IEnumSpellingError>();
+	auto hr = spellchecker->Check(word, &spellingErrors);
+	if (!(SUCCEEDED(hr) && spellingErrors)) {
+		return false;
+	}
+	auto spellingError = ComPtr<ISpellingError>();
+	auto startIndex = ULONG(0);
+	auto errorLength = ULONG(0);
+	auto action = CORRECTIVE_ACTION_NONE;
+	hr = spellingErrors->Next(&spellingError);
+	return !(SUCCEEDED(hr)
+		&& spellingError
+		&& SUCCEEDED(spellingError->get_StartIndex(&startIndex))
+		&& SUCCEEDED(spellingError->get_Length(&errorLength))
+		&& SUCCEEDED(spellingError->get_CorrectiveAction(&action))
+		&& (action == CORRECTIVE_ACTION_GET_SUGGESTIONS
+			|| action == CORRECTIVE_ACTION_REPLACE));
+}
+
+// The spellchecker marks words not from its own language as misspelled.
+// So we only return words that are marked
+// as misspelled in all spellcheckers.
+// The spellcheckers that failed to check the text are skipped.
+[[nodiscard]] MisspelledWords Intersect(
+		std::vector<std::optional<MisspelledWords>> found) {
+	const auto first = ranges::find_if(found, [](const auto &words) {
+		return words.has_value();
+	});
+	if (first == end(found)) {
+		return {};
+	}
+	auto result = std::move(**first);
+	for (auto i = first + 1; i != end(found) && !result.empty(); ++i) {
+		if (!*i) {
+			continue;
+		}
+		auto &other = **i;
+		ranges::sort(other);
+		result = result | ranges::views::filter([&](const auto &word) {
+			return ranges::binary_search(other, word);
+		}) | ranges::to_vector;
+	}
+	return result;
+}
+
+// ISpellChecker objects are not documented as safe to be called from
+// any thread, so each of them is created and used on its own thread.
+// This way the languages are still checked at the same time,
+// and no COM object is called from another apartment.
+class LanguageThread final {
+public:
+	using Task = FnMut<void(not_null<ISpellChecker*> spellchecker)>;
+
+	explicit LanguageThread(QString langTag);
+	~LanguageThread();
+
+	[[nodiscard]] const QString &langTag() const;
+	[[nodiscard]] bool valid() const;
+
+	void post(Task task);
+
+private:
+	void run();
+
+	const QString _langTag;
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	std::deque<Task> _tasks;
+	bool _created = false;
+	bool _valid = false;
+	bool _finishing = false;
+	std::thread _thread;
+
+};
+
+LanguageThread::LanguageThread(QString langTag)
+: _langTag(std::move(langTag))
+, _thread([=] { run(); }) {
+	auto lock = std::unique_lock(_mutex);
+	_condition.wait(lock, [&] { return _created; });
+}
+
+LanguageThread::~LanguageThread() {
+	{
+		auto lock = std::unique_lock(_mutex);
+		_finishing = true;
+	}
+	_condition.notify_all();
+	_thread.join();
+}
+
+const QString &LanguageThread::langTag() const {
+	return _langTag;
+}
+
+bool LanguageThread::valid() const {
+	return _valid;
+}
+
+void LanguageThread::post(Task task) {
+	{
+		auto lock = std::unique_lock(_mutex);
+		_tasks.push_back(std::move(task));
+	}
+	_condition.notify_all();
+}
+
+void LanguageThread::run() {
+	const auto result = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+	auto spellchecker = SUCCEEDED(result)
+		? CreateSpellChecker(_langTag)
+		: nullptr;
+	{
+		auto lock = std::unique_lock(_mutex);
+		_created = true;
+		_valid = (spellchecker != nullptr);
+	}
+	_condition.notify_all();
+
+	while (spellchecker) {
+		auto task = Task();
+		{
+			auto lock = std::unique_lock(_mutex);
+			_condition.wait(lock, [&] {
+				return _finishing || !_tasks.empty();
+			});
+			if (_tasks.empty()) {
+				break;
+			}
+			task = std::move(_tasks.front());
+			_tasks.pop_front();
+		}
+		task(spellchecker.Get());
+	}
+	spellchecker = nullptr;
+	if (SUCCEEDED(result)) {
+		CoUninitialize();
+	}
+}
+
+// WindowsSpellChecker class is used to store all the language threads
+// and control their lifetime. The class also provides wrappers for
+// ISpellChecker APIs, the calls are made on the threads of the languages.
 class WindowsSpellChecker {
 public:
 	WindowsSpellChecker();
@@ -55,7 +264,8 @@ public:
 	void addWord(LPCWSTR word);
 	void removeWord(LPCWSTR word);
 	void ignoreWord(LPCWSTR word);
-	[[nodiscard]] bool checkSpelling(LPCWSTR word);
+	[[nodiscard]] std::vector<bool> checkSpellingWords(
+		const std::vector<QStringView> &words);
 	void fillSuggestionList(
 		LPCWSTR wrongWord,
 		std::vector<QString> *optionalSuggestions);
@@ -65,81 +275,58 @@ public:
 		int offset);
 	[[nodiscard]] std::vector<QString> systemLanguages();
 	void chunkedCheckSpellingText(
-		QStringView textView,
+		const QString &text,
 		MisspelledWords *misspelledWords);
 
 private:
-	void createFactory();
-	[[nodiscard]] bool isLanguageSupported(const LPCWSTR &lang);
-	void createSpellCheckers();
+	// Runs the task on the threads of all the languages at once,
+	// and waits for all of them to finish.
+	void invokeAll(Fn<void(
+		int index,
+		not_null<ISpellChecker*> spellchecker)> task);
 
-	ComPtr<ISpellCheckerFactory> _spellcheckerFactory;
-	std::vector<std::pair<QString, ComPtr<ISpellChecker>>> _spellcheckerMap;
+	std::vector<std::unique_ptr<LanguageThread>> _threads;
 
 };
 
 WindowsSpellChecker::WindowsSpellChecker() {
-	createFactory();
-	createSpellCheckers();
-}
-
-void WindowsSpellChecker::createFactory() {
-	if (FAILED(CoCreateInstance(
-		__uuidof(SpellCheckerFactory),
-		nullptr,
-		(CLSCTX_INPROC_SERVER | CLSCTX_LOCAL_SERVER),
-		IID_PPV_ARGS(&_spellcheckerFactory)))) {
-		_spellcheckerFactory = nullptr;
-	}
-}
-
-void WindowsSpellChecker::createSpellCheckers() {
-	if (!_spellcheckerFactory) {
-		return;
-	}
 	for (const auto &lang : SystemLanguages()) {
-		const auto wlang = Q2WString(lang);
-		if (!isLanguageSupported(wlang)) {
-			continue;
-		}
-		if (ranges::contains(ranges::views::keys(_spellcheckerMap), lang)) {
-			continue;
-		}
-		auto spellchecker = ComPtr<ISpellChecker>();
-		auto hr = _spellcheckerFactory->CreateSpellChecker(
-			wlang,
-			&spellchecker);
-		if (SUCCEEDED(hr)) {
-			_spellcheckerMap.push_back({ lang, spellchecker });
+		auto thread = std::make_unique<LanguageThread>(lang);
+		if (thread->valid()) {
+			_threads.push_back(std::move(thread));
 		}
 	}
 }
 
-bool WindowsSpellChecker::isLanguageSupported(const LPCWSTR &lang) {
-	if (!_spellcheckerFactory) {
-		return false;
+void WindowsSpellChecker::invokeAll(Fn<void(
+		int index,
+		not_null<ISpellChecker*> spellchecker)> task) {
+	auto done = std::latch(std::ptrdiff_t(_threads.size()));
+	for (auto i = 0; i != int(_threads.size()); ++i) {
+		_threads[i]->post([&, i](not_null<ISpellChecker*> spellchecker) {
+			task(i, spellchecker);
+			done.count_down();
+		});
 	}
-
-	auto isSupported = (BOOL)false;
-	auto hr = _spellcheckerFactory->IsSupported(lang, &isSupported);
-	return SUCCEEDED(hr) && isSupported;
+	done.wait();
 }
 
 void WindowsSpellChecker::fillSuggestionList(
 		LPCWSTR wrongWord,
 		std::vector<QString> *optionalSuggestions) {
-	auto i = 0;
-	for (const auto &[langTag, spellchecker] : _spellcheckerMap) {
-		if (IsPersianLanguage(langTag)) {
-			continue;
+	auto found = std::vector<std::vector<QString>>(_threads.size());
+	invokeAll([&](int index, not_null<ISpellChecker*> spellchecker) {
+		if (IsPersianLanguage(_threads[index]->langTag())) {
+			return;
 		}
 		auto suggestions = ComPtr<IEnumString>();
 		auto hr = spellchecker->Suggest(wrongWord, &suggestions);
 		if (hr != S_OK) {
-			continue;
+			return;
 		}
 
-		while (true) {
+		auto &list = found[index];
+		while (int(list.size()) < kMaxSuggestions) {
 			wchar_t *suggestion = nullptr;
 			hr = suggestions->Next(1, &suggestion, nullptr);
 			if (hr != S_OK) {
@@ -150,147 +337,131 @@ void WindowsSpellChecker::fillSuggestionList(
 				wcslen(suggestion));
 			CoTaskMemFree(suggestion);
 			if (!guess.isEmpty()) {
-				optionalSuggestions->push_back(guess);
-				if (++i >= kMaxSuggestions) {
-					return;
-				}
+				list.push_back(guess);
+			}
+		}
+	});
+
+	// The suggestions are taken in the order of the languages.
+	auto i = 0;
+	for (auto &list : found) {
+		for (auto &guess : list) {
+			optionalSuggestions->push_back(std::move(guess));
+			if (++i >= kMaxSuggestions) {
+				return;
 			}
 		}
 	}
 }
 
-bool WindowsSpellChecker::checkSpelling(LPCWSTR word) {
-	for (const auto &[_, spellchecker] : _spellcheckerMap) {
-		auto spellingErrors = ComPtr<IEnumSpellingError>();
-		auto hr = spellchecker->Check(word, &spellingErrors);
-
-		if (SUCCEEDED(hr) && spellingErrors) {
-			auto spellingError = ComPtr<ISpellingError>();
-			auto startIndex = ULONG(0);
-			auto errorLength = ULONG(0);
-			auto action = CORRECTIVE_ACTION_NONE;
-			hr = spellingErrors->Next(&spellingError);
-			if (SUCCEEDED(hr) &&
-				spellingError &&
-				SUCCEEDED(spellingError->get_StartIndex(&startIndex)) &&
-				SUCCEEDED(spellingError->get_Length(&errorLength)) &&
-				SUCCEEDED(spellingError->get_CorrectiveAction(&action)) &&
-				(action == CORRECTIVE_ACTION_GET_SUGGESTIONS ||
-					action == CORRECTIVE_ACTION_REPLACE)) {
-			} else {
-				return true;
-			}
+std::vector<bool> WindowsSpellChecker::checkSpellingWords(
+		const std::vector<QStringView> &words) {
+	// ISpellChecker wants null-terminated words.
+	auto terminated = std::vector<std::vector<wchar_t>>();
+	terminated.reserve(words.size());
+	for (const auto &word : words) {
+		auto &buffer = terminated.emplace_back(word.size() + 1);
+		const auto count = word.toWCharArray(buffer.data());
+		buffer[count] = '\0';
+	}
+
+	// A word is correct if any of the spellcheckers says so.
+	auto found = std::vector<std::vector<bool>>(
+		_threads.size(),
+		std::vector<bool>(words.size(), false));
+	invokeAll([&](int index, not_null<ISpellChecker*> spellchecker) {
+		auto &verdicts = found[index];
+		for (auto i = 0; i != int(terminated.size()); ++i) {
+			const auto word = (LPCWSTR)terminated[i].data();
+			verdicts[i] = IsWordCorrect(spellchecker, word);
 		}
+	});
+	auto result = std::vector<bool>(words.size(), false);
+	for (auto i = 0; i != int(words.size()); ++i) {
+		result[i] = ranges::any_of(found, [&](const auto &verdicts) {
+			return verdicts[i];
+		});
 	}
-	return false;
+	return result;
 }
 
 void WindowsSpellChecker::checkSpellingText(
 		LPCWSTR text,
 		MisspelledWords *misspelledWordRanges,
 		int offset) {
-	// The spellchecker marks words not from its own language as misspelled.
-	// So we only return words that are marked
-	// as misspelled in all spellcheckers.
-	auto misspelledWords = MisspelledWords();
-
-	constexpr auto isActionGood = [](auto action) {
-		return action == CORRECTIVE_ACTION_GET_SUGGESTIONS
-			|| action == CORRECTIVE_ACTION_REPLACE;
-	};
-
-	for (const auto &[langTag, spellchecker] : _spellcheckerMap) {
-		auto spellingErrors = ComPtr<IEnumSpellingError>();
-
-		auto hr = IsPersianLanguage(langTag)
-			? spellchecker->Check(text, &spellingErrors)
-			: spellchecker->ComprehensiveCheck(text, &spellingErrors);
-		if (!(SUCCEEDED(hr) && spellingErrors)) {
-			continue;
-		}
-
-		auto tempMisspelled = MisspelledWords();
-		auto spellingError = ComPtr<ISpellingError>();
-		for (; hr == S_OK; hr = spellingErrors->Next(&spellingError)) {
-			auto startIndex = ULONG(0);
-			auto errorLength = ULONG(0);
-			auto action = CORRECTIVE_ACTION_NONE;
-
-			if (!(SUCCEEDED(hr)
-				&& spellingError
-				&& SUCCEEDED(spellingError->get_StartIndex(&startIndex))
-				&& SUCCEEDED(spellingError->get_Length(&errorLength))
-				&& SUCCEEDED(spellingError->get_CorrectiveAction(&action))
-				&& isActionGood(action))) {
-				continue;
-			}
-			const auto word = std::pair(
-				(int)startIndex + offset,
-				(int)errorLength);
-			if (misspelledWords.empty()
-				|| ranges::contains(misspelledWords, word)) {
-				tempMisspelled.push_back(std::move(word));
-			}
-		}
-		// If the tempMisspelled vector is empty at least once,
-		// it means that the all words will be correct in the end
-		// and it makes no sense to check other languages.
-		if (tempMisspelled.empty()) {
-			return;
-		}
-		misspelledWords = std::move(tempMisspelled);
-	}
+	auto found = std::vector<std::optional<MisspelledWords>>(
+		_threads.size());
+	invokeAll([&](int index, not_null<ISpellChecker*> spellchecker) {
+		found[index] = CheckWith(
+			_threads[index]->langTag(),
+			spellchecker,
+			text,
+			offset);
+	});
+	auto misspelledWords = Intersect(std::move(found));
 	if (offset) {
 		for (auto &m : misspelledWords) {
 			misspelledWordRanges->push_back(std::move(m));
 		}
 	} else {
-		*misspelledWordRanges = misspelledWords;
+		*misspelledWordRanges = std::move(misspelledWords);
 	}
 }
 
 void WindowsSpellChecker::addWord(LPCWSTR word) {
-	for (const auto &[_, spellchecker] : _spellcheckerMap) {
+	invokeAll([&](int, not_null<ISpellChecker*> spellchecker) {
 		spellchecker->Add(word);
-	}
+	});
 }
 
 void WindowsSpellChecker::removeWord(LPCWSTR word) {
-	for (const auto &[_, spellchecker] : _spellcheckerMap) {
+	invokeAll([&](int, not_null<ISpellChecker*> spellchecker) {
 		auto spellchecker2 = ComPtr<ISpellChecker2>();
 		spellchecker->QueryInterface(IID_PPV_ARGS(&spellchecker2));
 		if (spellchecker2) {
 			spellchecker2->Remove(word);
 		}
-	}
+	});
 }
 
 void WindowsSpellChecker::ignoreWord(LPCWSTR word) {
-	for (const auto &[_, spellchecker] : _spellcheckerMap) {
+	invokeAll([&](int, not_null<ISpellChecker*> spellchecker) {
 		spellchecker->Ignore(word);
-	}
+	});
 }
 
 std::vector<QString> WindowsSpellChecker::systemLanguages() {
-	return ranges::views::keys(_spellcheckerMap) | ranges::to_vector;
+	return ranges::views::all(
+		_threads
+	) | ranges::views::transform([](const auto &thread) {
+		return thread->langTag();
+	}) | ranges::to_vector;
 }
 
 void WindowsSpellChecker::chunkedCheckSpellingText(
-		QStringView textView,
+		const QString &text,
 		MisspelledWords *misspelledWords) {
-	auto i = 0;
-	auto chunkBuffer = std::vector<wchar_t>();
+	struct Chunk {
+		int offset = 0;
+		LPCWSTR data = nullptr;
+		std::vector<wchar_t> copy;
+	};
+	auto chunks = std::vector<Chunk>();
 
-	while (i != textView.size()) {
+	// The text itself is not changed, so only the last chunk,
+	// that is terminated by the string, is passed without a copy.
+	const auto data = text.utf16();
+	auto i = 0;
+	while (i != text.size()) {
 		const auto provisionalChunkSize = std::min(
 			kChunk,
-			int(textView.size() - i));
+			int(text.size() - i));
 		const auto chunkSize = [&] {
 			const auto until = std::max(
 				0,
 				provisionalChunkSize - ::Spellchecker::kMaxWordSize);
 			for (auto n = provisionalChunkSize; n > until; n--) {
-				if (textView.at(i + n - 1).isLetterOrNumber()) {
+				if (text.at(i + n - 1).isLetterOrNumber()) {
 					continue;
 				} else {
 					return n;
@@ -298,17 +469,46 @@ void WindowsSpellChecker::chunkedCheckSpellingText(
 			}
 			return provisionalChunkSize;
 		}();
-		const auto chunk = textView.mid(i, chunkSize);
-
-		chunkBuffer.resize(chunk.size() + 1);
-		const auto count = chunk.toWCharArray(chunkBuffer.data());
-		chunkBuffer[count] = '\0';
+		auto &chunk = chunks.emplace_back(Chunk{ i });
+		if (i + chunkSize == text.size()) {
+			chunk.data = (LPCWSTR)(data + i);
+		} else {
+			chunk.copy.resize(chunkSize + 1);
+			memcpy(
+				chunk.copy.data(),
+				data + i,
+				chunkSize * sizeof(wchar_t));
+			chunk.copy[chunkSize] = '\0';
+			chunk.data = chunk.copy.data();
+		}
+		i += chunkSize;
+	}
 
-		checkSpellingText(
-			(LPCWSTR)chunkBuffer.data(),
-			misspelledWords,
-			i);
-		i += chunk.size();
+	// Each spellchecker checks all the chunks on its thread,
+	// while the other spellcheckers check them on theirs.
+	const auto checkers = int(_threads.size());
+	auto found = std::vector<std::optional<MisspelledWords>>(
+		chunks.size() * checkers);
+	invokeAll([&](int index, not_null<ISpellChecker*> spellchecker) {
+		const auto &langTag = _threads[index]->langTag();
+		for (auto c = 0; c != int(chunks.size()); ++c) {
+			const auto &chunk = chunks[c];
+			found[c * checkers + index] = CheckWith(
+				langTag,
+				spellchecker,
+				chunk.data,
+				chunk.offset);
+		}
+	});
+	for (auto c = 0; c != int(chunks.size()); ++c) {
+		const auto from = begin(found) + c * checkers;
+		auto words = Intersect(std::vector<std::optional<MisspelledWords>>(
+			std::make_move_iterator(from),
+			std::make_move_iterator(from + checkers)));
+		misspelledWords->insert(
+			end(*misspelledWords),
+			begin(words),
+			end(words));
 	}
 }
 
@@ -321,9 +521,7 @@ WindowsSpellChecker &SharedSpellChecker() {
 
 } // namespace
 
-// TODO: Add a better work with the Threading Models.
-// All COM objects should be created asynchronously
-// if we want to work with them asynchronously.
+// All COM objects are created and used on the threads of their languages.
 // Some calls can be made in the main thread before spellchecking
 // (e.g. KnownLanguages), so we have to init it asynchronously first.
 void Init() {
@@ -349,7 +547,19 @@ bool CheckSpelling(const QString &wordToCheck) {
 	if (!IsSystemSpellchecker()) {
 		return ThirdParty::CheckSpelling(wordToCheck);
 	}
-	return SharedSpellChecker().checkSpelling(Q2WString(wordToCheck));
+	return SharedSpellChecker().checkSpellingWords({
+		QStringView(wordToCheck),
+	}).front();
+}
+
+std::vector<bool> CheckSpellingWords(const std::vector<QStringView> &words) {
+	if (!IsSystemSpellchecker()) {
+		return ThirdParty::CheckSpellingWords(words);
+	}
+	::Spellchecker::Count(
+		::Spellchecker::Counter::SystemWords,
+		int64(words.size()));
+	return SharedSpellChecker().checkSpellingWords(words);
 }
 
 void FillSuggestionList(
@@ -366,6 +576,27 @@ void FillSuggestionList(
 		optionalSuggestions);
 }
 
+void FillSuggestionListByParts(
+		const QString &wrongWord,
+		Fn<bool(std::vector<QString> &&part)> callback) {
+	if (!IsSystemSpellchecker()) {
+		ThirdParty::FillSuggestionListByParts(wrongWord, std::move(callback));
+		return;
+	}
+	auto variants = std::vector<QString>();
+	SharedSpellChecker().fillSuggestionList(Q2WString(wrongWord), &variants);
+	if (!variants.empty()) {
+		callback(std::move(variants));
+	}
+}
+
+void PrefetchSuggestions(std::vector<QString> words) {
+	// The system spellchecker suggests fast enough without it.
+	if (!IsSystemSpellchecker()) {
+		ThirdParty::PrefetchSuggestions(std::move(words));
+	}
+}
+
 void AddWord(const QString &word) {
 	if (IsSystemSpellchecker()) {
 		SharedSpellChecker().addWord(Q2WString(word));
@@ -418,7 +649,7 @@ void CheckSpellingText(
 		// There are certain strings with a lot of 'paragraph separators'
 		// that crash the native Windows spellchecker. We replace them
 		// with spaces (no difference for the checking), they don't crash.
-		const auto check = QString(text).replace(QChar(8233), QChar(32));
+		auto check = QString(text).replace(QChar(8233), QChar(32));
 		if (check.size() > kChunk) {
 			// On some versions of Windows 10,
 			// checking large text with specific characters (e.g. @)
@@ -0,0 +1,454 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "spellcheck/platform/platform_language.h"
+#include "spellcheck/platform/platform_spellcheck.h"
+#include "spellcheck/spellcheck_highlight_syntax.h"
+#include "spellcheck/spellcheck_stats.h"
+#include "spellcheck/spellcheck_utils.h"
+#include "spellcheck/spellcheck_value.h"
+#include "crl/crl_on_main.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QEvent>
+#include <QtCore/QFile>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <new>
+
+// Usage: lib_spellcheck_bench [options]
+//   --dictionaries <path>  the working dir with the Hunspell dictionaries,
+//   --languages <ids>      comma separated ids, LANGUAGE * 1000 + COUNTRY,
+//                          a language without a dictionary is waited for
+//                          until the load timeout,
+//   --corpus <file>        an UTF-8 text to use instead of the built-in one,
+//   --iterations <count>   the repeats of each measurement.
+
+namespace {
+
+std::atomic<int64> Allocations/* = 0*/;
+
+} // namespace
+
+void *operator new(std::size_t size) {
+	Allocations.fetch_add(1, std::memory_order_relaxed);
+	if (const auto result = std::malloc(size ? size : 1)) {
+		return result;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+	std::free(pointer);
+}
+
+namespace Spellchecker {
+namespace {
+
+constexpr auto kDefaultIterations = 5;
+constexpr auto kCorpusRepeats = 64;
+constexpr auto kCodeBlocks = 256;
+constexpr auto kLoadTimeout = crl::time(30000);
+
+const auto kMultilingual = u""
+	"The quick brown fox jumps over the lazy dog, speling misteaks "
+	"included. Съешь же ещё этих мягких французских булок, да выпей "
+	"чаю. Falsches Üben von Xylophonmusik quält jeden größeren Zwerg. "
+	"Portez ce vieux whisky au juge blond qui fume sur son île. "
+	"עטלף אבק נס דרך מזגן שהתפוצץ כי חם. "
+	"نص حكيم له سر قاطع وذو شأن عظيم مكتوب على ثوب أخضر. "
+	"Dès Noël où un zéphyr haï me vêt de glaçons würmiens. "
+	"敏捷的棕色狐狸跳过了懒狗。 Пiд'їжджає ґазда. "
+	"Visit https://example.com or write to @username #hashtag 😀.\n"_q;
+
+const auto kCode = u""
+	"template <typename Value>\n"
+	"[[nodiscard]] std::vector<Value> Filter(std::vector<Value> v) {\n"
+	"\t// Keeps only the positive values.\n"
+	"\tauto result = std::vector<Value>();\n"
+	"\tfor (const auto &value : v) {\n"
+	"\t\tif (value > 0) {\n"
+	"\t\t\tresult.push_back(value); /* block comment */\n"
+	"\t\t}\n"
+	"\t}\n"
+	"\treturn result;\n"
+	"}\n"_q;
+
+class MainQueueProcessor final : public QObject {
+public:
+	MainQueueProcessor() {
+		crl::init_main_queue([](void (*callable)(void*), void *argument) {
+			QCoreApplication::postEvent(
+				Instance,
+				new Event(callable, argument));
+		});
+		Instance = this;
+	}
+
+protected:
+	bool event(QEvent *e) override {
+		if (e->type() != Event::kType) {
+			return QObject::event(e);
+		}
+		static_cast<Event*>(e)->process();
+		return true;
+	}
+
+private:
+	class Event final : public QEvent {
+	public:
+		static constexpr auto kType = QEvent::Type(QEvent::User + 1);
+
+		Event(void (*callable)(void*), void *argument)
+		: QEvent(kType)
+		, _callable(callable)
+		, _argument(argument) {
+		}
+
+		void process() {
+			_callable(_argument);
+		}
+
+	private:
+		void (*_callable)(void*);
+		void *_argument;
+
+	};
+
+	static inline MainQueueProcessor *Instance = nullptr;
+
+};
+
+struct Options {
+	QString dictionaries;
+	std::vector<int> languages;
+	QString corpus;
+	int iterations = kDefaultIterations;
+};
+
+[[nodiscard]] Options ParseOptions(const QStringList &arguments) {
+	auto result = Options();
+	for (auto i = 1; i + 1 < arguments.size(); i += 2) {
+		const auto &key = arguments[i];
+		const auto &value = arguments[i + 1];
+		if (key == u"--dictionaries"_q) {
+			result.dictionaries = value;
+		} else if (key == u"--languages"_q) {
+			for (const auto &id : value.split(',', Qt::SkipEmptyParts)) {
+				result.languages.push_back(id.toInt());
+			}
+		} else if (key == u"--corpus"_q) {
+			result.corpus = value;
+		} else if (key == u"--iterations"_q) {
+			result.iterations = std::max(value.toInt(), 1);
+		}
+	}
+	return result;
+}
+
+[[nodiscard]] QString Repeated(const QString &text, int count) {
+	auto result = QString();
+	result.reserve(text.size() * count);
+	for (auto i = 0; i != count; ++i) {
+		result.append(text);
+	}
+	return result;
+}
+
+[[nodiscard]] QString LoadCorpus(const Options &options) {
+	if (options.corpus.isEmpty()) {
+		return Repeated(kMultilingual + kCode, kCorpusRepeats);
+	}
+	auto f = QFile(options.corpus);
+	if (!f.open(QIODevice::ReadOnly)) {
+		std::fprintf(
+			stderr,
+			"Could not open the corpus: %s\n",
+			options.corpus.toUtf8().constData());
+		return QString();
+	}
+	return QString::fromUtf8(f.readAll());
+}
+
+[[nodiscard]] std::vector<QStringView> Words(const QString &text) {
+	return ranges::views::all(
+		RangesFromText(text, [](QStringView) { return false; })
+	) | ranges::views::transform([&](const MisspelledWord &range) {
+		return QStringView(text).mid(range.first, range.second);
+	}) | ranges::to_vector;
+}
+
+[[nodiscard]] int64 NowMicroseconds() {
+	using namespace std::chrono;
+	return duration_cast<microseconds>(
+		steady_clock::now().time_since_epoch()).count();
+}
+
+void ProcessEventsFor(crl::time timeout, Fn<bool()> done) {
+	const auto till = crl::now() + timeout;
+	while (!done() && crl::now() < till) {
+		QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+	}
+}
+
+// Reports the throughput of one iteration of the callback,
+// by the best of the iterations, and the allocations it makes.
+void Measure(
+		const char *name,
+		int iterations,
+		double units,
+		const char *unit,
+		Fn<void()> callback) {
+	auto best = std::numeric_limits<int64>::max();
+	auto allocations = std::numeric_limits<int64>::max();
+	for (auto i = 0; i != iterations; ++i) {
+		const auto allocated = Allocations.load();
+		const auto started = NowMicroseconds();
+		callback();
+		const auto time = NowMicroseconds() - started;
+		best = std::min(best, std::max(time, int64(1)));
+		allocations = std::min(allocations, Allocations.load() - allocated);
+	}
+	const auto perSecond = units * 1000000. / double(best);
+	std::printf(
+		"%-24s %12.3f ms %14.1f %s/s %12lld allocations\n",
+		name,
+		double(best) / 1000.,
+		perSecond,
+		unit,
+		static_cast<long long>(allocations));
+}
+
+[[nodiscard]] double Megabytes(const QString &text) {
+	return double(text.size() * sizeof(QChar)) / (1024. * 1024.);
+}
+
+void BenchTokenizer(const Options &options, const QString &text) {
+	const auto words = int64(Words(text).size());
+	const auto megabytes = Megabytes(text);
+	Measure("RangesFromText", options.iterations, megabytes, "MB", [&] {
+		[[maybe_unused]] const auto ranges = RangesFromText(text, [](
+				QStringView word) {
+			return IsWordSkippable(word, false);
+		});
+	});
+	const auto views = Words(text);
+	Measure("IsWordSkippable", options.iterations, words, "words", [&] {
+		for (const auto &word : views) {
+			[[maybe_unused]] const auto skippable = IsWordSkippable(
+				word,
+				false);
+		}
+	});
+}
+
+// The dictionaries are loaded by the scripts of the checked words,
+// so only the languages of the scripts of the corpus are waited for.
+[[nodiscard]] std::vector<QString> ExpectedLanguages(
+		const Options &options,
+		const std::vector<QStringView> &words) {
+	auto scripts = std::vector<QChar::Script>();
+	for (const auto &word : words) {
+		const auto script = WordScript(word);
+		if (!ranges::contains(scripts, script)) {
+			scripts.push_back(script);
+		}
+	}
+	auto result = std::vector<QString>();
+	for (const auto id : options.languages) {
+		const auto lang = LocaleFromLangId(id).name();
+		if (ranges::contains(scripts, LocaleToScriptCode(lang))) {
+			result.push_back(lang);
+		}
+	}
+	return result;
+}
+
+void WaitForDictionaries(
+		const Options &options,
+		const std::vector<QStringView> &words) {
+	const auto expected = ExpectedLanguages(options, words);
+	const auto loaded = [&] {
+		const auto active = Platform::Spellchecker::ActiveLanguages();
+		return int(ranges::count_if(expected, [&](const QString &lang) {
+			return ranges::contains(active, lang);
+		}));
+	};
+
+	// Each loaded dictionary changes the verdicts of its script,
+	// the active languages are updated by that time.
+	auto changed = true;
+	auto lifetime = rpl::lifetime();
+	SpellcheckChanged(
+	) | rpl::start_with_next([&](const SpellcheckChange &) {
+		changed = true;
+	}, lifetime);
+	ProcessEventsFor(kLoadTimeout, [&] {
+		if (!base::take(changed)) {
+			return false;
+		}
+		[[maybe_unused]] const auto verdicts
+			= Platform::Spellchecker::CheckSpellingWords(words);
+		return loaded() == int(expected.size());
+	});
+	std::printf(
+		"Loaded languages: %d of %d\n",
+		loaded(),
+		int(expected.size()));
+}
+
+void BenchSpellchecker(const Options &options, const QString &text) {
+	const auto views = Words(text);
+	const auto words = int64(views.size());
+
+	if (!Platform::Spellchecker::IsSystemSpellchecker()) {
+		WaitForDictionaries(options, views);
+	}
+
+	Measure("CheckSpellingWords", options.iterations, words, "words", [&] {
+		[[maybe_unused]] const auto verdicts
+			= Platform::Spellchecker::CheckSpellingWords(views);
+	});
+	Measure("CheckSpelling", options.iterations, words, "words", [&] {
+		for (const auto &word : views) {
+			[[maybe_unused]] const auto correct
+				= Platform::Spellchecker::CheckSpelling(word.toString());
+		}
+	});
+
+	const auto verdicts = Platform::Spellchecker::CheckSpellingWords(views);
+	auto misspelled = std::vector<QString>();
+	for (auto i = 0; i != int(views.size()); ++i) {
+		const auto word = views[i].toString();
+		if (!verdicts[i] && !ranges::contains(misspelled, word)) {
+			misspelled.push_back(word);
+		}
+	}
+	Measure(
+		"FillSuggestionList",
+		1,
+		int64(misspelled.size()),
+		"words",
+		[&] {
+			auto suggestions = std::vector<QString>();
+			for (const auto &word : misspelled) {
+				Platform::Spellchecker::FillSuggestionList(
+					word,
+					&suggestions);
+			}
+		});
+}
+
+void BenchHighlighting(const Options &options) {
+	auto texts = std::vector<TextWithEntities>();
+	texts.reserve(kCodeBlocks);
+	for (auto i = 0; i != kCodeBlocks; ++i) {
+		// Every block is different, so nothing is taken from the cache.
+		auto text = TextWithEntities{
+			Repeated(kCode, 1 + (i % 8)) + u"// %1\n"_q.arg(i),
+		};
+		text.entities.push_back(EntityInText(
+			EntityType::Pre,
+			0,
+			int(text.text.size()),
+			u"cpp"_q));
+		texts.push_back(std::move(text));
+	}
+	auto total = QString();
+	for (const auto &text : texts) {
+		total.append(text.text);
+	}
+
+	// The first block waits for the grammars.
+	auto warmup = TextWithEntities{ kCode };
+	warmup.entities.push_back(
+		EntityInText(EntityType::Pre, 0, int(kCode.size()), u"cpp"_q));
+	auto ready = 0;
+	auto lifetime = rpl::lifetime();
+	HighlightReady() | rpl::start_with_next([&] {
+		++ready;
+	}, lifetime);
+	if (TryHighlightSyntax(warmup)) {
+		ProcessEventsFor(kLoadTimeout, [&] { return ready > 0; });
+	}
+
+	const auto megabytes = Megabytes(total);
+	Measure("TryHighlightSyntax", 1, megabytes, "MB", [&] {
+		auto copies = texts;
+		ready = 0;
+		auto scheduled = 0;
+		for (auto &text : copies) {
+			scheduled += TryHighlightSyntax(text) ? 1 : 0;
+		}
+		ProcessEventsFor(kLoadTimeout, [&] { return ready >= scheduled; });
+	});
+	const auto iterations = options.iterations;
+	Measure("TryHighlightSyntax/cache", iterations, megabytes, "MB", [&] {
+		auto copies = texts;
+		for (auto &text : copies) {
+			[[maybe_unused]] const auto id = TryHighlightSyntax(text);
+		}
+	});
+}
+
+void BenchRecognize(const Options &options, const QString &text) {
+	const auto lines = text.split('\n', Qt::SkipEmptyParts);
+	const auto views = ranges::views::all(
+		lines
+	) | ranges::views::transform([](const QString &line) {
+		return QStringView(line);
+	}) | ranges::to_vector;
+	const auto megabytes = Megabytes(text);
+	Measure("Recognize", options.iterations, megabytes, "MB", [&] {
+		for (const auto &line : views) {
+			[[maybe_unused]] const auto id
+				= Platform::Language::Recognize(line);
+		}
+	});
+	Measure("Recognize/batch", options.iterations, megabytes, "MB", [&] {
+		[[maybe_unused]] const auto ids = Platform::Language::Recognize(views);
+	});
+}
+
+} // namespace
+} // namespace Spellchecker
+
+int main(int argc, char *argv[]) {
+	using namespace Spellchecker;
+
+	auto application = QCoreApplication(argc, argv);
+	const auto processor = MainQueueProcessor();
+	const auto options = ParseOptions(application.arguments());
+	const auto corpus = LoadCorpus(options);
+	const auto words = int(Words(corpus).size());
+	if (!words) {
+		std::fprintf(stderr, "The corpus has no words.\n");
+		return 1;
+	}
+	std::printf("Corpus: %.2f MB, %d words\n", Megabytes(corpus), words);
+
+	if (!options.dictionaries.isEmpty()) {
+		SetWorkingDirPath(options.dictionaries);
+	}
+	Platform::Spellchecker::Init();
+	Platform::Spellchecker::UpdateLanguages(options.languages);
+
+	BenchTokenizer(options, corpus);
+	BenchSpellchecker(options, corpus);
+	BenchHighlighting(options);
+	BenchRecognize(options, corpus);
+
+	std::printf("%s\n", FormatStats(Stats()).toUtf8().constData());
+	return 0;
+}
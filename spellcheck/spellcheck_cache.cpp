@@ -0,0 +1,101 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "spellcheck/spellcheck_cache.h"
+
+#include "spellcheck/spellcheck_stats.h"
+
+namespace Spellchecker {
+
+VerdictCache::VerdictCache(int limit)
+: _cache(limit) {
+}
+
+// Thread: Any.
+VerdictCache::Epoch VerdictCache::epoch() const {
+	return _epoch.load();
+}
+
+// Thread: Any.
+std::optional<bool> VerdictCache::find(QStringView word) {
+	// The key is used only for the lookup, so it doesn't copy the data.
+	const auto key = QString::fromRawData(word.data(), word.size());
+
+	std::lock_guard lock(_mutex);
+	const auto verdict = _cache.find(key);
+	if (!verdict || verdict->epoch != _epoch.load()) {
+		Count(Counter::VerdictCacheMisses);
+		return std::nullopt;
+	}
+	Count(Counter::VerdictCacheHits);
+	return verdict->correct;
+}
+
+// Thread: Any.
+void VerdictCache::store(QStringView word, bool correct, Epoch epoch) {
+	std::lock_guard lock(_mutex);
+	if (epoch != _epoch.load()) {
+		// The dictionaries were changed during the check.
+		return;
+	}
+	_cache.emplace(word.toString(), { epoch, correct });
+}
+
+// Thread: Any.
+void VerdictCache::invalidate() {
+	std::lock_guard lock(_mutex);
+	++_epoch;
+	_cache.clear();
+}
+
+SuggestionsCache::SuggestionsCache(int limit)
+: _cache(limit) {
+}
+
+// Thread: Any.
+SuggestionsCache::Epoch SuggestionsCache::epoch() const {
+	return _epoch.load();
+}
+
+// Thread: Any.
+auto SuggestionsCache::find(const QString &word)
+-> std::optional<std::vector<QString>> {
+	std::lock_guard lock(_mutex);
+	if (const auto list = _cache.find(word)) {
+		Count(Counter::SuggestionsCacheHits);
+		return *list;
+	}
+	Count(Counter::SuggestionsCacheMisses);
+	return std::nullopt;
+}
+
+// Thread: Any.
+bool SuggestionsCache::contains(const QString &word) {
+	std::lock_guard lock(_mutex);
+	return _cache.find(word) != nullptr;
+}
+
+// Thread: Any.
+void SuggestionsCache::store(
+		const QString &word,
+		std::vector<QString> list,
+		Epoch epoch) {
+	std::lock_guard lock(_mutex);
+	if (epoch != _epoch.load()) {
+		// The dictionaries were changed during the search.
+		return;
+	}
+	_cache.emplace(word, std::move(list));
+}
+
+// Thread: Any.
+void SuggestionsCache::invalidate() {
+	std::lock_guard lock(_mutex);
+	++_epoch;
+	_cache.clear();
+}
+
+} // namespace Spellchecker
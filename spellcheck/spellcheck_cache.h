@@ -0,0 +1,153 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace Spellchecker {
+
+// Not thread-safe, every user should guard it by itself.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache final {
+public:
+	explicit LruCache(int64 limit) : _limit(limit) {
+	}
+
+	[[nodiscard]] Value *find(const Key &key) {
+		const auto i = _map.find(key);
+		if (i == end(_map)) {
+			return nullptr;
+		}
+		_list.splice(begin(_list), _list, i->second);
+		return &i->second->value;
+	}
+
+	void emplace(Key key, Value value, int64 cost = 1) {
+		remove(key);
+		_list.push_front({ key, std::move(value), cost });
+		_map.emplace(std::move(key), begin(_list));
+		_cost += cost;
+		trim(_limit);
+	}
+
+	void remove(const Key &key) {
+		const auto i = _map.find(key);
+		if (i != end(_map)) {
+			_cost -= i->second->cost;
+			_list.erase(i->second);
+			_map.erase(i);
+		}
+	}
+
+	void clear() {
+		_map.clear();
+		_list.clear();
+		_cost = 0;
+	}
+
+	// Evicts the least recently used entries until the cost fits.
+	void trim(int64 limit) {
+		while (_cost > limit && !_list.empty()) {
+			const auto &last = _list.back();
+			_cost -= last.cost;
+			_map.erase(last.key);
+			_list.pop_back();
+		}
+	}
+
+	void setLimit(int64 limit) {
+		_limit = limit;
+		trim(_limit);
+	}
+
+	[[nodiscard]] int64 limit() const {
+		return _limit;
+	}
+	[[nodiscard]] int64 cost() const {
+		return _cost;
+	}
+	[[nodiscard]] int size() const {
+		return int(_map.size());
+	}
+
+private:
+	struct Entry {
+		Key key;
+		Value value;
+		int64 cost = 0;
+	};
+
+	std::list<Entry> _list;
+	std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> _map;
+	int64 _limit = 0;
+	int64 _cost = 0;
+
+};
+
+struct QStringHash {
+	[[nodiscard]] size_t operator()(const QString &value) const {
+		return qHash(value);
+	}
+};
+
+// Remembers results of the spellchecking of separate words.
+// Every change of the dictionaries should call invalidate(),
+// so the results that were computed before it are never stored.
+class VerdictCache final {
+public:
+	using Epoch = uint64;
+
+	explicit VerdictCache(int limit);
+
+	// Should be taken before the actual check of a word.
+	[[nodiscard]] Epoch epoch() const;
+
+	[[nodiscard]] std::optional<bool> find(QStringView word);
+	void store(QStringView word, bool correct, Epoch epoch);
+	void invalidate();
+
+private:
+	struct Verdict {
+		Epoch epoch = 0;
+		bool correct = false;
+	};
+
+	mutable std::mutex _mutex;
+	std::atomic<Epoch> _epoch = 0;
+	LruCache<QString, Verdict, QStringHash> _cache;
+
+};
+
+// Remembers complete suggestion lists of the misspelled words.
+// It follows the same rules of invalidation as VerdictCache.
+class SuggestionsCache final {
+public:
+	using Epoch = uint64;
+
+	explicit SuggestionsCache(int limit);
+
+	[[nodiscard]] Epoch epoch() const;
+
+	[[nodiscard]] std::optional<std::vector<QString>> find(
+		const QString &word);
+	[[nodiscard]] bool contains(const QString &word);
+	void store(const QString &word, std::vector<QString> list, Epoch epoch);
+	void invalidate();
+
+private:
+	mutable std::mutex _mutex;
+	std::atomic<Epoch> _epoch = 0;
+	LruCache<QString, std::vector<QString>, QStringHash> _cache;
+
+};
+
+} // namespace Spellchecker
@@ -0,0 +1,141 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include <catch2/catch.hpp>
+
+#include "spellcheck/spellcheck_cache.h"
+
+using namespace Spellchecker;
+
+TEST_CASE("lru cache", "[spellcheck_cache]") {
+	auto cache = LruCache<int, int>(3);
+	cache.emplace(1, 10);
+	cache.emplace(2, 20);
+	cache.emplace(3, 30);
+	REQUIRE(cache.size() == 3);
+	REQUIRE(cache.cost() == 3);
+
+	SECTION("least recently used entry is evicted") {
+		REQUIRE(cache.find(1) != nullptr);
+		cache.emplace(4, 40);
+		REQUIRE(cache.size() == 3);
+		REQUIRE(cache.find(2) == nullptr);
+		REQUIRE(*cache.find(1) == 10);
+		REQUIRE(*cache.find(3) == 30);
+		REQUIRE(*cache.find(4) == 40);
+	}
+
+	SECTION("emplace replaces the value and its cost") {
+		cache.emplace(2, 21, 2);
+		REQUIRE(*cache.find(2) == 21);
+		REQUIRE(cache.cost() == 3);
+		REQUIRE(cache.size() == 2);
+		REQUIRE(cache.find(1) == nullptr);
+	}
+
+	SECTION("entry larger than the limit is not kept") {
+		cache.emplace(4, 40, 4);
+		REQUIRE(cache.find(4) == nullptr);
+		REQUIRE(cache.cost() == 0);
+		REQUIRE(cache.size() == 0);
+	}
+
+	SECTION("remove and trim") {
+		cache.remove(2);
+		cache.remove(5);
+		REQUIRE(cache.find(2) == nullptr);
+		REQUIRE(cache.cost() == 2);
+
+		cache.trim(1);
+		REQUIRE(cache.size() == 1);
+		REQUIRE(*cache.find(3) == 30);
+		REQUIRE(cache.limit() == 3);
+
+		cache.setLimit(0);
+		REQUIRE(cache.size() == 0);
+		REQUIRE(cache.cost() == 0);
+	}
+}
+
+TEST_CASE("verdict cache", "[spellcheck_cache]") {
+	auto cache = VerdictCache(2);
+
+	SECTION("verdicts are stored for the current epoch") {
+		const auto epoch = cache.epoch();
+		cache.store(u"good", true, epoch);
+		cache.store(u"bda", false, epoch);
+		REQUIRE(cache.find(u"good") == std::make_optional(true));
+		REQUIRE(cache.find(u"bda") == std::make_optional(false));
+		REQUIRE(cache.find(u"other") == std::nullopt);
+	}
+
+	SECTION("invalidate forgets the verdicts") {
+		cache.store(u"good", true, cache.epoch());
+		cache.invalidate();
+		REQUIRE(cache.find(u"good") == std::nullopt);
+	}
+
+	SECTION("verdict computed before invalidate is not stored") {
+		const auto epoch = cache.epoch();
+		cache.invalidate();
+		cache.store(u"good", true, epoch);
+		REQUIRE(cache.find(u"good") == std::nullopt);
+
+		cache.store(u"good", true, cache.epoch());
+		REQUIRE(cache.find(u"good") == std::make_optional(true));
+	}
+
+	SECTION("the limit is kept") {
+		const auto epoch = cache.epoch();
+		cache.store(u"one", true, epoch);
+		cache.store(u"two", true, epoch);
+		cache.store(u"three", true, epoch);
+		REQUIRE(cache.find(u"one") == std::nullopt);
+		REQUIRE(cache.find(u"two") == std::make_optional(true));
+		REQUIRE(cache.find(u"three") == std::make_optional(true));
+	}
+
+	SECTION("the key doesn't depend on the source of the view") {
+		const auto text = u"some good text"_q;
+		cache.store(QStringView(text).mid(5, 4), true, cache.epoch());
+		REQUIRE(cache.find(u"good") == std::make_optional(true));
+		REQUIRE(cache.find(QStringView(text).mid(5, 3)) == std::nullopt);
+	}
+}
+
+TEST_CASE("suggestions cache", "[spellcheck_cache]") {
+	using List = std::vector<QString>;
+	auto cache = SuggestionsCache(2);
+
+	SECTION("lists are stored for the current epoch") {
+		cache.store(u"helo"_q, { u"hello"_q, u"help"_q }, cache.epoch());
+		cache.store(u"wrld"_q, {}, cache.epoch());
+		REQUIRE(cache.contains(u"helo"_q));
+		REQUIRE(cache.find(u"helo"_q) == List{ u"hello"_q, u"help"_q });
+		REQUIRE(cache.find(u"wrld"_q) == List());
+		REQUIRE(cache.find(u"other"_q) == std::nullopt);
+	}
+
+	SECTION("list searched before invalidate is not stored") {
+		const auto epoch = cache.epoch();
+		cache.store(u"helo"_q, { u"hello"_q }, epoch);
+		cache.invalidate();
+		REQUIRE(!cache.contains(u"helo"_q));
+
+		cache.store(u"helo"_q, { u"hello"_q }, epoch);
+		REQUIRE(!cache.contains(u"helo"_q));
+	}
+
+	SECTION("the limit is kept") {
+		const auto epoch = cache.epoch();
+		cache.store(u"one"_q, {}, epoch);
+		cache.store(u"two"_q, {}, epoch);
+		cache.store(u"three"_q, {}, epoch);
+		REQUIRE(!cache.contains(u"one"_q));
+		REQUIRE(cache.contains(u"two"_q));
+		REQUIRE(cache.contains(u"three"_q));
+	}
+}
@@ -6,6 +6,8 @@
 //
 #include "spellcheck/spellcheck_highlight_syntax.h"
 
+#include "spellcheck/spellcheck_cache.h"
+#include "spellcheck/spellcheck_stats.h"
 #include "base/base_file_utilities.h"
 #include "base/debug_log.h"
 #include "base/flat_map.h"
@@ -13,11 +15,15 @@
 
 #include "SyntaxHighlighter.h"
 
-#include <QtCore/QFile>
+#include <QtCore/QResource>
 
 #include <xxhash.h>
-#include <variant>
+#include <array>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 
 void spellchecker_InitHighlightingResource() {
 #ifdef Q_OS_MAC // Use resources from the .app bundle on macOS.
@@ -34,33 +40,98 @@ void spellchecker_InitHighlightingResource() {
 namespace Spellchecker {
 namespace {
 
-base::flat_map<XXH64_hash_t, EntitiesInText> Cache;
+constexpr auto kCacheLimit = int64(4 * 1024 * 1024);
+
+// The approximate overhead of an entry of the LRU in bytes.
+constexpr auto kCacheEntryCost = int64(64);
+
+constexpr auto kMaxWorkers = 4;
+constexpr auto kMaxColorIndex = 8;
+
+// Thread: Main.
+LruCache<XXH64_hash_t, EntitiesInText> Cache(kCacheLimit);
 HighlightProcessId ProcessIdAutoIncrement/* = 0*/;
+
+// Thread: Main.
+// The scheduled blocks with the processes that wait for them.
+std::unordered_map<XXH64_hash_t, std::vector<HighlightProcessId>> InFlight;
 rpl::event_stream<HighlightProcessId> ReadyStream;
 
+struct Request {
+	uint64 hash = 0;
+	QString text;
+	QString language;
+	int64 scheduled = 0;
+};
+
+// The requests are shared by all the workers,
+// each worker takes the shortest one when it is free.
+class PendingRequests final {
+public:
+	void push(Request request);
+	[[nodiscard]] std::optional<Request> takeShortest();
+
+private:
+	std::mutex _mutex;
+	std::multimap<int, Request> _requests;
+
+};
+
 class QueuedHighlighter final {
 public:
 	QueuedHighlighter();
 
-	struct Request {
-		uint64 hash = 0;
-		QString text;
-		QString language;
-	};
+	void prepare();
 	void process(Request request);
-	void notify(HighlightProcessId id);
 
 private:
-	using Task = std::variant<Request, HighlightProcessId>;
+	std::unique_ptr<SyntaxHighlighter> _highlighter;
 
-	std::vector<Task> _tasks;
+};
 
-	std::unique_ptr<SyntaxHighlighter> _highlighter;
+struct Worker {
+	crl::object_on_queue<QueuedHighlighter> highlighter;
 
+	// Thread: Main.
+	int scheduled = 0;
 };
 
-[[nodiscard]] crl::object_on_queue<QueuedHighlighter> &Highlighter() {
-	static auto result = crl::object_on_queue<QueuedHighlighter>();
+[[nodiscard]] PendingRequests &Pending() {
+	static auto result = PendingRequests();
+	return result;
+}
+
+// Each worker has its own SyntaxHighlighter,
+// so a large block doesn't hold the others on a single queue.
+[[nodiscard]] std::vector<std::unique_ptr<Worker>> &Workers() {
+	static auto result = [] {
+		const auto count = std::clamp(
+			int(std::thread::hardware_concurrency()) / 2,
+			1,
+			kMaxWorkers);
+		auto workers = std::vector<std::unique_ptr<Worker>>();
+		workers.reserve(count);
+		for (auto i = 0; i != count; ++i) {
+			workers.push_back(std::make_unique<Worker>());
+		}
+		return workers;
+	}();
+	return result;
+}
+
+void PendingRequests::push(Request request) {
+	const auto size = int(request.text.size());
+	std::lock_guard lock(_mutex);
+	_requests.emplace(size, std::move(request));
+}
+
+std::optional<Request> PendingRequests::takeShortest() {
+	std::lock_guard lock(_mutex);
+	if (_requests.empty()) {
+		return std::nullopt;
+	}
+	auto result = std::move(begin(_requests)->second);
+	_requests.erase(begin(_requests));
 	return result;
 }
 
@@ -73,22 +144,50 @@ private:
 	return (i != end(kAliases)) ? i->second : language;
 }
 
+// Counts the UTF-16 code units of the text without converting it.
+[[nodiscard]] int Utf16Length(const std::string &utf8) {
+	auto result = 0;
+	for (const auto ch : utf8) {
+		const auto byte = uchar(ch);
+		if ((byte & 0xC0) != 0x80) {
+			// The four bytes sequences take a surrogate pair.
+			result += (byte >= 0xF0) ? 2 : 1;
+		}
+	}
+	return result;
+}
+
+// The entity data is shared with the table of colors,
+// so only the entities themselves and the overhead are counted.
+[[nodiscard]] int64 EntitiesCost(const EntitiesInText &entities) {
+	return kCacheEntryCost
+		+ int64(entities.size() * sizeof(EntityInText));
+}
+
 QueuedHighlighter::QueuedHighlighter() {
-	spellchecker_InitHighlightingResource();
+	[[maybe_unused]] static const auto initialized = [] {
+		spellchecker_InitHighlightingResource();
+		return true;
+	}();
 }
 
-void QueuedHighlighter::process(Request request) {
-	if (!_highlighter) {
-		auto file = QFile(":/misc/grammars.dat");
-		const auto size = file.size();
-		const auto ok1 = file.open(QIODevice::ReadOnly);
-		auto grammars = std::string();
-		grammars.resize(size);
-		const auto ok2 = (file.read(grammars.data(), size) == size);
-		Assert(ok1 && ok2);
-
-		_highlighter = std::make_unique<SyntaxHighlighter>(grammars);
+void QueuedHighlighter::prepare() {
+	if (_highlighter) {
+		return;
 	}
+	// The compressed resource is unpacked once,
+	// it is read without the QFile buffers.
+	const auto resource = QResource(u":/misc/grammars.dat"_q);
+	Assert(resource.isValid());
+	const auto data = resource.uncompressedData();
+	Assert(!data.isEmpty());
+
+	_highlighter = std::make_unique<SyntaxHighlighter>(
+		std::string(data.constData(), data.size()));
+}
+
+void QueuedHighlighter::process(Request request) {
+	prepare();
 
 	const auto text = request.text.toStdString();
 	const auto language = LookupAlias(request.language.toLower());
@@ -124,55 +223,67 @@ void QueuedHighlighter::process(Request request) {
 		{ "inserted"     , 8 },
 	};
 
+	// The entity data is shared by all the entities of the same color.
+	static const auto colorData = [] {
+		auto result = std::array<QString, kMaxColorIndex + 1>();
+		for (auto i = 1; i <= kMaxColorIndex; ++i) {
+			result[i] = QString(QChar(ushort(i)));
+		}
+		return result;
+	}();
+
 	auto offset = 0;
 	auto entities = EntitiesInText();
-	auto rebuilt = QString();
-	rebuilt.reserve(request.text.size());
 	const auto enumerate = [&](
 			const TokenList &list,
-			const std::string &type,
+			int color,
 			auto &&self) -> void {
 		for (const auto &node : list) {
 			if (node.isSyntax()) {
 				const auto &syntax = static_cast<const Syntax&>(node);
-				self(syntax.children(), syntax.type(), self);
+				const auto i = colors.find(syntax.type());
+				self(
+					syntax.children(),
+					(i != end(colors)) ? i->second : 0,
+					self);
 			} else {
-				const auto text = static_cast<const Text&>(node).value();
-				const auto utf16 = QString::fromUtf8(
-					text.data(),
-					text.size());
-				const auto length = utf16.size();
-				rebuilt.append(utf16);
-				if (!type.empty()) {
-					const auto i = colors.find(type);
-					if (i != end(colors)) {
-						entities.push_back(EntityInText(
-							EntityType::Colorized,
-							offset,
-							length,
-							QChar(ushort(i->second))));
-					}
+				const auto &text = static_cast<const Text&>(node).value();
+				const auto length = Utf16Length(text);
+				if (color) {
+					entities.push_back(EntityInText(
+						EntityType::Colorized,
+						offset,
+						length,
+						colorData[color]));
 				}
 				offset += length;
 			}
 		}
 	};
-	enumerate(tokens, std::string(), enumerate);
+	enumerate(tokens, 0, enumerate);
 	const auto hash = request.hash;
+	const auto scheduled = request.scheduled;
 	if (offset != request.text.size()) {
 		// Something went wrong.
 		LOG(("Highlighting Error: for language '%1', text: %2"
 			).arg(request.language, request.text));
 		entities.clear();
 	}
-	crl::on_main([hash, entities = std::move(entities)]() mutable {
-		Cache.emplace(hash, std::move(entities));
-	});
-}
-
-void QueuedHighlighter::notify(HighlightProcessId id) {
-	crl::on_main([=] {
-		ReadyStream.fire_copy(id);
+	crl::on_main([=, entities = std::move(entities)]() mutable {
+		const auto cost = EntitiesCost(entities);
+		Cache.emplace(hash, std::move(entities), cost);
+		Count(Counter::HighlightFinished);
+		Record(Timing::HighlightLatency, StatsNow() - scheduled);
+
+		const auto i = InFlight.find(hash);
+		if (i == end(InFlight)) {
+			return;
+		}
+		const auto processIds = std::move(i->second);
+		InFlight.erase(i);
+		for (const auto processId : processIds) {
+			ReadyStream.fire_copy(processId);
+		}
 	});
 }
 
@@ -206,8 +317,7 @@ struct CacheResult {
 	XXH64_update(state, language.data(), language.size() * sizeof(ushort));
 	const auto hash = XXH64_digest(state);
 
-	const auto j = Cache.find(hash);
-	return { hash, (j != Cache.cend()) ? &j->second : nullptr };
+	return { hash, Cache.find(hash) };
 }
 
 EntitiesInText::iterator Insert(
@@ -239,19 +349,41 @@ EntitiesInText::iterator Insert(
 void Schedule(
 		uint64 hash,
 		const TextWithEntities &text,
-		EntitiesInText::const_iterator i) {
-	Highlighter().with([
+		EntitiesInText::const_iterator i,
+		HighlightProcessId processId) {
+	const auto j = InFlight.find(hash);
+	if (j != end(InFlight)) {
+		// The same block is highlighted already, so only wait for it.
+		if (!ranges::contains(j->second, processId)) {
+			j->second.push_back(processId);
+		}
+		return;
+	}
+	InFlight.emplace(hash, std::vector<HighlightProcessId>{ processId });
+
+	Count(Counter::HighlightScheduled);
+	Pending().push({
 		hash,
-		text = text.text.mid(i->offset(), i->length()),
-		language = i->data()
-	](QueuedHighlighter &instance) mutable {
-		instance.process({ hash, std::move(text), std::move(language) });
+		text.text.mid(i->offset(), i->length()),
+		i->data(),
+		StatsNow(),
 	});
-}
 
-void Notify(uint64 processId) {
-	Highlighter().with([processId](QueuedHighlighter &instance) {
-		instance.notify(processId);
+	// Every scheduled task takes one request, the shortest at that time.
+	auto &workers = Workers();
+	const auto &worker = *ranges::min_element(workers, ranges::less(), [](
+			const std::unique_ptr<Worker> &worker) {
+		return worker->scheduled;
+	});
+	++worker->scheduled;
+	worker->highlighter.with([raw = worker.get()](
+			QueuedHighlighter &instance) {
+		if (auto request = Pending().takeShortest()) {
+			instance.process(std::move(*request));
+		}
+		crl::on_main([=] {
+			--raw->scheduled;
+		});
 	});
 }
 
@@ -275,16 +407,13 @@ HighlightProcessId TryHighlightSyntax(TextWithEntities &text) {
 			b = text.entities.begin();
 			e = text.entities.end();
 		} else {
-			Schedule(already.hash, text, i);
 			if (!processId) {
 				processId = ++ProcessIdAutoIncrement;
 			}
+			Schedule(already.hash, text, i, processId);
 			++i;
 		}
 	}
-	if (processId) {
-		Notify(processId);
-	}
 	return processId;
 }
 
@@ -292,4 +421,20 @@ rpl::producer<HighlightProcessId> HighlightReady() {
 	return ReadyStream.events();
 }
 
+int64 HighlightCacheEstimatedSize() {
+	return Cache.cost();
+}
+
+void TrimHighlightCache(int64 size) {
+	Cache.trim(size);
+}
+
+void PreloadHighlighting() {
+	for (const auto &worker : Workers()) {
+		worker->highlighter.with([](QueuedHighlighter &instance) {
+			instance.prepare();
+		});
+	}
+}
+
 } // namespace Spellchecker
@@ -14,6 +14,22 @@ using HighlightProcessId = uint64;
 
 // Returning zero means we highlighted everything already.
 [[nodiscard]] HighlightProcessId TryHighlightSyntax(TextWithEntities &text);
+
+// Fires the process id each time one of its blocks is highlighted,
+// so the text may be highlighted again and get this block at once.
 [[nodiscard]] rpl::producer<HighlightProcessId> HighlightReady();
 
+// The results are cached in an LRU limited by their size in bytes,
+// which is the size of the entities and the estimated LRU overhead.
+// The library doesn't watch the memory pressure, the application should
+// call TrimHighlightCache() when it is notified about one.
+[[nodiscard]] int64 HighlightCacheEstimatedSize();
+void TrimHighlightCache(int64 size);
+
+// Loads the grammars on the highlighter queues in advance,
+// so the first highlighted block doesn't wait for them.
+// The library never calls it by itself, the application may call it
+// once code blocks are about to be shown, for example on a chat open.
+void PreloadHighlighting();
+
 } // namespace Spellchecker
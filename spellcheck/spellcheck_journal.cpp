@@ -0,0 +1,36 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "spellcheck/spellcheck_journal.h"
+
+namespace Spellchecker {
+
+JournalReplay ApplyJournal(
+		std::unordered_set<QString, QStringHash> &words,
+		const QByteArray &journal) {
+	auto result = JournalReplay();
+	for (auto record : QString::fromUtf8(journal).split(QChar('\n'))) {
+		// The records written on Windows end with "\r\n".
+		if (record.endsWith(QChar('\r'))) {
+			record.chop(1);
+		}
+		if (record.isEmpty()) {
+			continue;
+		}
+		const auto word = record.mid(1);
+		if (record.front() == QChar::fromLatin1(kJournalAdded)) {
+			words.emplace(word);
+		} else if (record.front() == QChar::fromLatin1(kJournalRemoved)) {
+			words.erase(word);
+		} else {
+			result.broken = true;
+		}
+		++result.records;
+	}
+	return result;
+}
+
+} // namespace Spellchecker
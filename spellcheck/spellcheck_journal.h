@@ -0,0 +1,32 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include "spellcheck/spellcheck_cache.h"
+
+#include <unordered_set>
+
+namespace Spellchecker {
+
+// Each record of the journal takes a line,
+// it is the operation followed by the word in UTF-8.
+inline constexpr auto kJournalAdded = '+';
+inline constexpr auto kJournalRemoved = '-';
+
+struct JournalReplay {
+	int records = 0;
+
+	// Some records are unknown, the journal should be rewritten.
+	bool broken = false;
+};
+
+// Applies the records to the words in the order they were written.
+JournalReplay ApplyJournal(
+	std::unordered_set<QString, QStringHash> &words,
+	const QByteArray &journal);
+
+} // namespace Spellchecker
@@ -0,0 +1,71 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include <catch2/catch.hpp>
+
+#include "spellcheck/spellcheck_journal.h"
+
+using namespace Spellchecker;
+
+TEST_CASE("journal replay", "[spellcheck_journal]") {
+	auto words = std::unordered_set<QString, QStringHash>{ u"old"_q };
+
+	SECTION("records are applied in the order they were written") {
+		const auto replay = ApplyJournal(
+			words,
+			"+first\n+second\n-first\n-old\n+old\n");
+		REQUIRE(replay.records == 5);
+		REQUIRE(!replay.broken);
+		REQUIRE(words == std::unordered_set<QString, QStringHash>{
+			u"second"_q,
+			u"old"_q,
+		});
+	}
+
+	SECTION("records may end with carriage returns") {
+		const auto replay = ApplyJournal(words, "+first\r\n-old\r\n");
+		REQUIRE(replay.records == 2);
+		REQUIRE(!replay.broken);
+		REQUIRE(words == std::unordered_set<QString, QStringHash>{
+			u"first"_q,
+		});
+	}
+
+	SECTION("empty lines are not records") {
+		const auto replay = ApplyJournal(words, "\n\r\n+first\n\n");
+		REQUIRE(replay.records == 1);
+		REQUIRE(!replay.broken);
+		REQUIRE(words.contains(u"first"_q));
+	}
+
+	SECTION("the record without the last new line is applied") {
+		const auto replay = ApplyJournal(words, "+first\n+second");
+		REQUIRE(replay.records == 2);
+		REQUIRE(words.contains(u"second"_q));
+	}
+
+	SECTION("words are read in UTF-8") {
+		const auto replay = ApplyJournal(words, u"+слово\n"_q.toUtf8());
+		REQUIRE(replay.records == 1);
+		REQUIRE(words.contains(u"слово"_q));
+	}
+
+	SECTION("unknown records break the journal") {
+		const auto replay = ApplyJournal(words, "+first\n*second\n-old\n");
+		REQUIRE(replay.records == 3);
+		REQUIRE(replay.broken);
+		REQUIRE(words == std::unordered_set<QString, QStringHash>{
+			u"first"_q,
+		});
+	}
+
+	SECTION("nothing is changed by an empty journal") {
+		const auto replay = ApplyJournal(words, QByteArray());
+		REQUIRE(replay.records == 0);
+		REQUIRE(!replay.broken);
+		REQUIRE(words.size() == 1);
+	}
+}
@@ -0,0 +1,103 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "spellcheck/spellcheck_language.h"
+
+#include "spellcheck/platform/platform_language.h"
+#include "spellcheck/spellcheck_cache.h"
+#include "crl/crl_queue.h"
+
+#include <xxhash.h>
+
+namespace Spellchecker {
+namespace {
+
+constexpr auto kMaxRecognizedTexts = 4096;
+
+struct RecognizedLanguages {
+	std::mutex mutex;
+	LruCache<XXH64_hash_t, LanguageId> cache{ kMaxRecognizedTexts };
+};
+
+[[nodiscard]] RecognizedLanguages &Recognized() {
+	static auto result = RecognizedLanguages();
+	return result;
+}
+
+// Some of the backends keep a single recognizer,
+// so the asynchronous recognitions are ordered by the queue.
+[[nodiscard]] crl::queue &RecognizeQueue() {
+	static auto result = crl::queue();
+	return result;
+}
+
+[[nodiscard]] XXH64_hash_t TextHash(QStringView text) {
+	return XXH64(text.data(), text.size() * sizeof(QChar), 0);
+}
+
+[[nodiscard]] std::optional<LanguageId> Find(XXH64_hash_t hash) {
+	auto &recognized = Recognized();
+	std::lock_guard lock(recognized.mutex);
+	if (const auto id = recognized.cache.find(hash)) {
+		return *id;
+	}
+	return std::nullopt;
+}
+
+[[nodiscard]] LanguageId RecognizeAndStore(
+		XXH64_hash_t hash,
+		QStringView text) {
+	const auto result = Platform::Language::Recognize(text);
+
+	auto &recognized = Recognized();
+	std::lock_guard lock(recognized.mutex);
+	recognized.cache.emplace(hash, result);
+	return result;
+}
+
+} // namespace
+
+// Thread: Any.
+LanguageId RecognizeLanguage(QStringView text) {
+	const auto hash = TextHash(text);
+	if (const auto id = Find(hash)) {
+		return *id;
+	}
+	return RecognizeAndStore(hash, text);
+}
+
+// Thread: Main.
+rpl::producer<LanguageId> RecognizeLanguageAsync(QString text) {
+	return [text = std::move(text)](auto consumer) {
+		auto lifetime = rpl::lifetime();
+
+		const auto hash = TextHash(text);
+		if (const auto id = Find(hash)) {
+			consumer.put_next_copy(*id);
+			consumer.put_done();
+			return lifetime;
+		}
+
+		// It is changed and checked on the main thread only.
+		const auto alive = std::make_shared<bool>(true);
+		lifetime.add([=] {
+			*alive = false;
+		});
+
+		RecognizeQueue().async([=] {
+			const auto id = RecognizeAndStore(hash, text);
+			crl::on_main([=] {
+				if (*alive) {
+					consumer.put_next_copy(id);
+					consumer.put_done();
+				}
+			});
+		});
+		return lifetime;
+	};
+}
+
+} // namespace Spellchecker
@@ -0,0 +1,20 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include "spellcheck/spellcheck_types.h"
+
+namespace Spellchecker {
+
+// Remembers the recognized languages of the recent texts by their hashes.
+[[nodiscard]] LanguageId RecognizeLanguage(QStringView text);
+
+// Emits the language of the text once, the recognition itself
+// is done on a background queue and never on the main thread.
+[[nodiscard]] rpl::producer<LanguageId> RecognizeLanguageAsync(QString text);
+
+} // namespace Spellchecker
@@ -0,0 +1,129 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "spellcheck/spellcheck_stats.h"
+
+#include "base/assertion.h"
+
+#include <QtCore/QStringList>
+
+#include <atomic>
+
+namespace Spellchecker {
+namespace {
+
+struct AtomicTiming {
+	std::atomic<int64> count = 0;
+	std::atomic<int64> total = 0;
+	std::array<std::atomic<int64>, kStatsBuckets> buckets = {};
+};
+
+// The counters are only summed up, so the relaxed order is enough.
+std::array<std::atomic<int64>, int(Counter::kCount)> Counters = {};
+std::array<AtomicTiming, int(Timing::kCount)> Timings;
+
+[[nodiscard]] int Bucket(int64 microseconds) {
+	auto result = 0;
+	while (microseconds > 0 && result + 1 < kStatsBuckets) {
+		microseconds >>= 1;
+		++result;
+	}
+	return result;
+}
+
+[[nodiscard]] const char *CounterName(Counter counter) {
+	switch (counter) {
+	case Counter::HunspellWords: return "hunspell_words";
+	case Counter::SystemWords: return "system_words";
+	case Counter::VerdictCacheHits: return "verdict_cache_hits";
+	case Counter::VerdictCacheMisses: return "verdict_cache_misses";
+	case Counter::SuggestionsCacheHits: return "suggestions_cache_hits";
+	case Counter::SuggestionsCacheMisses: return "suggestions_cache_misses";
+	case Counter::CheckJobsStarted: return "check_jobs_started";
+	case Counter::CheckJobsDiscarded: return "check_jobs_discarded";
+	case Counter::HighlightScheduled: return "highlight_scheduled";
+	case Counter::HighlightFinished: return "highlight_finished";
+	case Counter::kCount: break;
+	}
+	Unexpected("Counter in CounterName.");
+}
+
+[[nodiscard]] const char *TimingName(Timing timing) {
+	switch (timing) {
+	case Timing::HunspellSpell: return "hunspell_spell";
+	case Timing::HunspellSuggest: return "hunspell_suggest";
+	case Timing::EngineLoad: return "engine_load";
+	case Timing::HighlightLatency: return "highlight_latency";
+	case Timing::kCount: break;
+	}
+	Unexpected("Timing in TimingName.");
+}
+
+} // namespace
+
+void Count(Counter counter, int64 value) {
+	Counters[int(counter)].fetch_add(value, std::memory_order_relaxed);
+}
+
+void Record(Timing timing, int64 microseconds) {
+	auto &stats = Timings[int(timing)];
+	stats.count.fetch_add(1, std::memory_order_relaxed);
+	stats.total.fetch_add(microseconds, std::memory_order_relaxed);
+	stats.buckets[Bucket(microseconds)].fetch_add(
+		1,
+		std::memory_order_relaxed);
+}
+
+int64 StatsNow() {
+	using namespace std::chrono;
+	return duration_cast<microseconds>(
+		steady_clock::now().time_since_epoch()).count();
+}
+
+StatsSnapshot Stats() {
+	auto result = StatsSnapshot();
+	for (auto i = 0; i != int(Counter::kCount); ++i) {
+		result.counters[i] = Counters[i].load(std::memory_order_relaxed);
+	}
+	for (auto i = 0; i != int(Timing::kCount); ++i) {
+		const auto &stats = Timings[i];
+		auto &to = result.timings[i];
+		to.count = stats.count.load(std::memory_order_relaxed);
+		to.total = stats.total.load(std::memory_order_relaxed);
+		for (auto j = 0; j != kStatsBuckets; ++j) {
+			to.buckets[j] = stats.buckets[j].load(std::memory_order_relaxed);
+		}
+	}
+	return result;
+}
+
+QString FormatStats(const StatsSnapshot &stats) {
+	auto result = QStringList();
+	for (auto i = 0; i != int(Counter::kCount); ++i) {
+		result.push_back(u"%1: %2"_q
+			.arg(QString::fromLatin1(CounterName(Counter(i))))
+			.arg(stats.counters[i]));
+	}
+	for (auto i = 0; i != int(Timing::kCount); ++i) {
+		const auto &timing = stats.timings[i];
+		auto buckets = QStringList();
+		for (auto j = 0; j != kStatsBuckets; ++j) {
+			if (timing.buckets[j]) {
+				buckets.push_back(u"<%1us:%2"_q
+					.arg(int64(1) << j)
+					.arg(timing.buckets[j]));
+			}
+		}
+		result.push_back(u"%1: count %2, total %3us [%4]"_q
+			.arg(QString::fromLatin1(TimingName(Timing(i))))
+			.arg(timing.count)
+			.arg(timing.total)
+			.arg(buckets.join(u" "_q)));
+	}
+	return result.join(u"\n"_q);
+}
+
+} // namespace Spellchecker
@@ -0,0 +1,89 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include <array>
+#include <chrono>
+
+namespace Spellchecker {
+
+enum class Counter {
+	HunspellWords,
+	SystemWords,
+	VerdictCacheHits,
+	VerdictCacheMisses,
+	SuggestionsCacheHits,
+	SuggestionsCacheMisses,
+	CheckJobsStarted,
+	CheckJobsDiscarded,
+	// Their difference is the depth of the highlighting queue.
+	HighlightScheduled,
+	HighlightFinished,
+
+	kCount,
+};
+
+enum class Timing {
+	HunspellSpell,
+	HunspellSuggest,
+	EngineLoad,
+	HighlightLatency,
+
+	kCount,
+};
+
+// The durations are in microseconds, the bucket N counts
+// the durations in [2^(N-1), 2^N), the last one counts the rest.
+constexpr auto kStatsBuckets = 24;
+
+struct TimingStats {
+	int64 count = 0;
+	int64 total = 0;
+	std::array<int64, kStatsBuckets> buckets = {};
+};
+
+struct StatsSnapshot {
+	std::array<int64, int(Counter::kCount)> counters = {};
+	std::array<TimingStats, int(Timing::kCount)> timings = {};
+
+	[[nodiscard]] int64 counter(Counter counter) const {
+		return counters[int(counter)];
+	}
+	[[nodiscard]] const TimingStats &timing(Timing timing) const {
+		return timings[int(timing)];
+	}
+};
+
+// Thread: Any.
+void Count(Counter counter, int64 value = 1);
+void Record(Timing timing, int64 microseconds);
+[[nodiscard]] int64 StatsNow();
+
+[[nodiscard]] StatsSnapshot Stats();
+[[nodiscard]] QString FormatStats(const StatsSnapshot &stats);
+
+// Records the time of its own lifetime.
+class StatsTimer final {
+public:
+	explicit StatsTimer(Timing timing)
+	: _timing(timing)
+	, _started(StatsNow()) {
+	}
+	~StatsTimer() {
+		Record(_timing, StatsNow() - _started);
+	}
+
+	StatsTimer(const StatsTimer &) = delete;
+	StatsTimer &operator=(const StatsTimer &) = delete;
+
+private:
+	Timing _timing;
+	int64 _started = 0;
+
+};
+
+} // namespace Spellchecker
@@ -10,6 +10,13 @@
 #include <QtCore/QStringList>
 #include <QTextBoundaryFinder>
 
+#include <array>
+#include <bit>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <optional>
+
 namespace Spellchecker {
 namespace {
 
@@ -20,8 +27,13 @@ struct SubtagScript {
 
 // https://chromium.googlesource.com/chromium/src/+/refs/heads/master/third_party/blink/renderer/platform/text/locale_to_script_mapping.cc
 
-std::vector<QChar::Script> SupportedScripts;
+constexpr auto kScriptsMaskSize = (int(QChar::ScriptCount) + 63) / 64;
+using ScriptsMask = std::array<uint64, kScriptsMaskSize>;
+
+// It is changed in the main thread and read from the spellchecking ones.
+std::array<std::atomic<uint64>, kScriptsMaskSize> SupportedScripts;
 rpl::event_stream<> SupportedScriptsEventStream;
+rpl::event_stream<SpellcheckChange> SpellcheckChangeEventStream;
 
 constexpr auto kFactor = 1000;
 
@@ -195,6 +207,57 @@ constexpr SubtagScript kLocaleScriptList[] = {
 	// {"zh-tw", USCRIPT_TRADITIONAL_HAN},
 };
 
+// Subtags have two or three lowercase letters,
+// so all of them fit a table indexed by the letters directly.
+constexpr auto kSubtagLetters = 27; // Zero stands for the missing letter.
+constexpr auto kMaxSubtagLength = 3;
+constexpr auto kSubtagIndexSize = kSubtagLetters
+	* kSubtagLetters
+	* kSubtagLetters;
+
+static_assert(int(QChar::ScriptCount) <= 256);
+
+template <typename Char>
+[[nodiscard]] constexpr int SubtagIndex(const Char *subtag, int length) {
+	if (length < 1 || length > kMaxSubtagLength) {
+		return -1;
+	}
+	auto result = 0;
+	for (auto i = 0; i != kMaxSubtagLength; ++i) {
+		result *= kSubtagLetters;
+		if (i < length) {
+			const auto c = subtag[i];
+			if (c < 'a' || c > 'z') {
+				return -1;
+			}
+			result += int(c - 'a') + 1;
+		}
+	}
+	return result;
+}
+
+[[nodiscard]] constexpr int SubtagLength(const char *subtag) {
+	auto result = 0;
+	while (subtag[result]) {
+		++result;
+	}
+	return result;
+}
+
+constexpr auto kLocaleScriptIndex = [] {
+	auto result = std::array<uchar, kSubtagIndexSize>();
+	for (auto &script : result) {
+		script = uchar(QChar::Script_Common);
+	}
+	for (const auto &[subtag, script] : kLocaleScriptList) {
+		const auto index = SubtagIndex(subtag, SubtagLength(subtag));
+		if (index >= 0) {
+			result[index] = uchar(script);
+		}
+	}
+	return result;
+}();
+
 inline auto IsAcuteAccentChar(const QChar &c) {
 	return ranges::contains(kAcuteAccentChars, c);
 }
@@ -203,36 +266,119 @@ inline auto IsSpellcheckableScripts(const QChar::Script &s) {
 	return !ranges::contains(kUnspellcheckableScripts, s);
 }
 
+[[nodiscard]] inline bool IsSupportedScript(QChar::Script script) {
+	const auto index = int(script);
+	const auto part = SupportedScripts[index / 64].load(
+		std::memory_order_relaxed);
+	return (part >> (index % 64)) & 1;
+}
+
+// Classes of the Latin-1 characters, so the words from them
+// don't need any lookup of the Unicode properties.
+constexpr auto kLatin1Letter = uchar(0x01); // Letter of Script_Latin.
+constexpr auto kLatin1Common = uchar(0x02); // Non-letter of Script_Common.
+constexpr auto kLatin1Unknown = uchar(0x04); // Should be looked up.
+
+constexpr auto kLatin1Classes = [] {
+	auto result = std::array<uchar, 256>();
+	for (auto i = 0; i != 256; ++i) {
+		const auto letter = (i >= 'A' && i <= 'Z')
+			|| (i >= 'a' && i <= 'z')
+			|| (i == 0xAA) // Feminine ordinal indicator.
+			|| (i == 0xBA) // Masculine ordinal indicator.
+			|| (i >= 0xC0 && i != 0xD7 && i != 0xF7);
+		result[i] = letter
+			? kLatin1Letter
+			: (i == 0xB5) // Micro sign is a letter of Script_Common.
+			? kLatin1Unknown
+			: (i == '\'' || i == '_') // They never make a word skippable.
+			? uchar(0)
+			: kLatin1Common;
+	}
+	return result;
+}();
+
+// Returns all the classes of the word characters combined,
+// or nothing if the word has characters outside of Latin-1.
+[[nodiscard]] std::optional<uchar> Latin1Classes(QStringView word) {
+	const auto data = word.utf16();
+	const auto size = int(word.size());
+
+	// Check four characters at once.
+	constexpr auto kHighBytes = uint64(0xFF00FF00FF00FF00ULL);
+	auto i = 0;
+	for (; i + 4 <= size; i += 4) {
+		auto chunk = uint64();
+		std::memcpy(&chunk, data + i, sizeof(chunk));
+		if (chunk & kHighBytes) {
+			return std::nullopt;
+		}
+	}
+	for (; i < size; ++i) {
+		if (data[i] & 0xFF00) {
+			return std::nullopt;
+		}
+	}
+
+	auto result = uchar(0);
+	for (i = 0; i < size; ++i) {
+		result |= kLatin1Classes[data[i]];
+	}
+	if (result & kLatin1Unknown) {
+		return std::nullopt;
+	}
+	return result;
+}
+
 } // namespace
 
-QChar::Script LocaleToScriptCode(const QString &locale) {
-	const auto subtag = locale.left(
-		std::max(locale.indexOf('_'), locale.indexOf('-')));
-	for (const auto &kv : kLocaleScriptList) {
-		if (subtag == kv.subtag) {
-			return kv.script;
+QChar::Script LocaleToScriptCode(QStringView locale) {
+	auto length = 0;
+	while (length != locale.size()
+		&& locale[length] != '_'
+		&& locale[length] != '-') {
+		if (++length > kMaxSubtagLength) {
+			return QChar::Script_Common;
 		}
 	}
-	return QChar::Script_Common;
+	const auto index = SubtagIndex(locale.utf16(), length);
+	return (index >= 0)
+		? QChar::Script(kLocaleScriptIndex[index])
+		: QChar::Script_Common;
 }
 
 QChar::Script WordScript(QStringView word) {
 	// Find the first letter.
-	const auto firstLetter = ranges::find_if(word, [](QChar c) {
-		return c.isLetter();
-	});
-	return firstLetter == word.end()
-		? QChar::Script_Common
-		: firstLetter->script();
+	for (const auto c : word) {
+		const auto code = c.unicode();
+		if ((code < 0x100) && !(kLatin1Classes[code] & kLatin1Unknown)) {
+			if (kLatin1Classes[code] & kLatin1Letter) {
+				return QChar::Script_Latin;
+			}
+		} else if (c.isLetter()) {
+			return c.script();
+		}
+	}
+	return QChar::Script_Common;
 }
 
 bool IsWordSkippable(QStringView word, bool checkSupportedScripts) {
 	if (word.size() > kMaxWordSize) {
 		return true;
 	}
+	if (const auto classes = Latin1Classes(word)) {
+		const auto wordScript = (*classes & kLatin1Letter)
+			? QChar::Script_Latin
+			: QChar::Script_Common;
+		if (checkSupportedScripts && !IsSupportedScript(wordScript)) {
+			return true;
+		}
+		// All non-letters here are of Script_Common.
+		return (wordScript == QChar::Script_Latin)
+			&& (*classes & kLatin1Common);
+	}
 	const auto wordScript = WordScript(word);
-	if (checkSupportedScripts
-		&& !ranges::contains(SupportedScripts, wordScript)) {
+	if (checkSupportedScripts && !IsSupportedScript(wordScript)) {
 		return true;
 	}
 	return ranges::any_of(word, [&](QChar c) {
@@ -243,32 +389,98 @@ bool IsWordSkippable(QStringView word, bool checkSupportedScripts) {
 	});
 }
 
-void UpdateSupportedScripts(std::vector<QString> languages) {
+void UpdateSupportedScripts(
+		std::vector<QString> languages,
+		std::vector<QChar::Script> changed) {
 	// It should be called at least once from Platform::Spellchecker::Init().
-	SupportedScripts = ranges::views::all(
-		languages
-	) | ranges::views::transform(
-		LocaleToScriptCode
-	) | ranges::views::unique | ranges::views::filter(
-		IsSpellcheckableScripts
-	) | ranges::to_vector;
+	auto mask = ScriptsMask();
+	for (const auto &language : languages) {
+		const auto script = LocaleToScriptCode(language);
+		if (IsSpellcheckableScripts(script)) {
+			mask[int(script) / 64] |= (uint64(1) << (int(script) % 64));
+		}
+	}
+	for (auto i = 0; i != kScriptsMaskSize; ++i) {
+		const auto was = SupportedScripts[i].exchange(
+			mask[i],
+			std::memory_order_relaxed);
+		for (auto bits = (was ^ mask[i]); bits; bits &= (bits - 1)) {
+			const auto script = QChar::Script(i * 64 + std::countr_zero(bits));
+			if (!ranges::contains(changed, script)) {
+				changed.push_back(script);
+			}
+		}
+	}
 	SupportedScriptsEventStream.fire({});
+
+	// Without the known scripts everything is checked again.
+	auto change = SpellcheckChange{ .all = changed.empty() };
+	change.scripts = std::move(changed);
+	SpellcheckChangeEventStream.fire(std::move(change));
 }
 
 rpl::producer<> SupportedScriptsChanged() {
 	return SupportedScriptsEventStream.events();
 }
 
+void NotifyWordsChanged(std::vector<QString> words) {
+	if (!words.empty()) {
+		SpellcheckChangeEventStream.fire({ .words = std::move(words) });
+	}
+}
+
+rpl::producer<SpellcheckChange> SpellcheckChanged() {
+	return SpellcheckChangeEventStream.events();
+}
+
+rpl::producer<std::vector<QString>> Suggestions(const QString &word) {
+	return [=](auto consumer) {
+		auto lifetime = rpl::lifetime();
+
+		// It is changed and checked on the main thread only,
+		// the worker just stops when the subscription is gone.
+		const auto alive = std::make_shared<std::atomic<bool>>(true);
+		lifetime.add([=] {
+			*alive = false;
+		});
+
+		crl::async([=] {
+			Platform::Spellchecker::FillSuggestionListByParts(word, [=](
+					std::vector<QString> &&part) {
+				if (!*alive) {
+					return false;
+				}
+				crl::on_main([=, part = std::move(part)]() mutable {
+					if (*alive) {
+						consumer.put_next(std::move(part));
+					}
+				});
+				return true;
+			});
+			crl::on_main([=] {
+				if (*alive) {
+					consumer.put_done();
+				}
+			});
+		});
+		return lifetime;
+	};
+}
+
 MisspelledWords RangesFromText(
-	const QString &text,
-	Fn<bool(const QString &word)> filterCallback) {
+	QStringView text,
+	Fn<bool(QStringView word)> filterCallback) {
 	MisspelledWords ranges;
 
 	if (text.isEmpty()) {
 		return ranges;
 	}
 
-	auto finder = QTextBoundaryFinder(QTextBoundaryFinder::Word, text);
+	// This constructor doesn't copy the text.
+	auto finder = QTextBoundaryFinder(
+		QTextBoundaryFinder::Word,
+		text.data(),
+		text.size());
 
 	const auto isEnd = [&] {
 		return (finder.toNextBoundary() == -1);
@@ -303,9 +515,59 @@ MisspelledWords RangesFromText(
 	return ranges;
 }
 
-bool CheckSkipAndSpell(const QString &word) {
+bool CheckSkipAndSpell(QStringView word) {
 	return !IsWordSkippable(word)
-		&& Platform::Spellchecker::CheckSpelling(word);
+		&& Platform::Spellchecker::CheckSpellingWords({ word }).front();
+}
+
+MisspelledWords CheckSkipAndSpellWords(
+		QStringView text,
+		Fn<std::vector<bool>(const std::vector<QStringView> &words)> check) {
+	const auto candidates = RangesFromText(text, [](QStringView word) {
+		return IsWordSkippable(word);
+	});
+	const auto words = ranges::views::all(
+		candidates
+	) | ranges::views::transform([&](const MisspelledWord &range) {
+		return text.mid(range.first, range.second);
+	}) | ranges::to_vector;
+	const auto verdicts = check(words);
+
+	auto result = MisspelledWords();
+	for (auto i = 0; i != candidates.size(); ++i) {
+		if (!verdicts[i]) {
+			result.push_back(candidates[i]);
+		}
+	}
+	return result;
+}
+
+void AppendUtf8(std::string &to, QStringView from) {
+	const auto size = from.size();
+	for (auto i = 0; i < size; ++i) {
+		auto code = char32_t(from[i].unicode());
+		if (QChar::isHighSurrogate(code)
+			&& (i + 1 < size)
+			&& from[i + 1].isLowSurrogate()) {
+			code = QChar::surrogateToUcs4(from[i], from[i + 1]);
+			++i;
+		}
+		if (code < 0x80) {
+			to.push_back(char(code));
+		} else if (code < 0x800) {
+			to.push_back(char(0xC0 | (code >> 6)));
+			to.push_back(char(0x80 | (code & 0x3F)));
+		} else if (code < 0x10000) {
+			to.push_back(char(0xE0 | (code >> 12)));
+			to.push_back(char(0x80 | ((code >> 6) & 0x3F)));
+			to.push_back(char(0x80 | (code & 0x3F)));
+		} else {
+			to.push_back(char(0xF0 | (code >> 18)));
+			to.push_back(char(0x80 | ((code >> 12) & 0x3F)));
+			to.push_back(char(0x80 | ((code >> 6) & 0x3F)));
+			to.push_back(char(0x80 | (code & 0x3F)));
+		}
+	}
 }
 
 QLocale LocaleFromLangId(int langId) {
@@ -318,4 +580,49 @@ QLocale LocaleFromLangId(int langId) {
 	return QLocale(lang, country);
 }
 
+void InvokeInParallel(int count, Fn<void(int index)> callback) {
+	if (count <= 1) {
+		if (count == 1) {
+			callback(0);
+		}
+		return;
+	}
+	struct State {
+		Fn<void(int)> callback;
+		std::atomic<int> next = 0;
+		int count = 0;
+		int finished = 0;
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+	const auto state = std::make_shared<State>();
+	state->callback = std::move(callback);
+	state->count = count;
+
+	// Indices are claimed one by one, so a worker that started after
+	// the calling thread took everything just does nothing.
+	// That way waiting in a pool thread can't lead to a deadlock.
+	const auto work = [](const std::shared_ptr<State> &state) {
+		auto processed = 0;
+		for (auto i = state->next++; i < state->count; i = state->next++) {
+			state->callback(i);
+			++processed;
+		}
+		if (processed) {
+			std::lock_guard lock(state->mutex);
+			state->finished += processed;
+			if (state->finished == state->count) {
+				state->done.notify_all();
+			}
+		}
+	};
+	for (auto i = 1; i != count; ++i) {
+		crl::async([=] { work(state); });
+	}
+	work(state);
+
+	std::unique_lock lock(state->mutex);
+	state->done.wait(lock, [&] { return state->finished == state->count; });
+}
+
 } // namespace Spellchecker
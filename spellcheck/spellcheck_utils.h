@@ -14,22 +14,57 @@ namespace Spellchecker {
 
 constexpr auto kMaxWordSize = 99;
 
-QChar::Script LocaleToScriptCode(const QString &locale);
+QChar::Script LocaleToScriptCode(QStringView locale);
 QChar::Script WordScript(QStringView word);
 bool IsWordSkippable(
 	QStringView word,
 	bool checkSupportedScripts = true);
 
+// The words are passed as views into the text, nothing is copied.
 MisspelledWords RangesFromText(
-	const QString &text,
-	Fn<bool(const QString &word)> filterCallback);
+	QStringView text,
+	Fn<bool(QStringView word)> filterCallback);
 
 // For Linux and macOS, which use RangesFromText.
-bool CheckSkipAndSpell(const QString &word);
+bool CheckSkipAndSpell(QStringView word);
+
+// Checks all the non-skippable words of the text by a single call.
+MisspelledWords CheckSkipAndSpellWords(
+	QStringView text,
+	Fn<std::vector<bool>(const std::vector<QStringView> &words)> check);
+
+// Appends the word to the buffer without intermediate allocations.
+void AppendUtf8(std::string &to, QStringView from);
 
 QLocale LocaleFromLangId(int langId);
 
-void UpdateSupportedScripts(std::vector<QString> languages);
+// Invokes the callback for each index in [0, count) on the crl pool.
+// The calling thread takes part in the work and waits until it is done.
+void InvokeInParallel(int count, Fn<void(int index)> callback);
+
+// Emits the suggestions for the word by parts as soon as they are found.
+// The search is stopped when the subscription is destroyed.
+rpl::producer<std::vector<QString>> Suggestions(const QString &word);
+
+struct SpellcheckChange {
+	// The verdicts of all the words may be changed.
+	bool all = false;
+
+	std::vector<QChar::Script> scripts;
+	std::vector<QString> words;
+};
+
+// The changed scripts are found by the languages,
+// the scripts with changed dictionaries may be added explicitly.
+void UpdateSupportedScripts(
+	std::vector<QString> languages,
+	std::vector<QChar::Script> changed = {});
 rpl::producer<> SupportedScriptsChanged();
 
+// Should be called when the words are added, removed or ignored.
+void NotifyWordsChanged(std::vector<QString> words);
+
+// Thread: Main.
+rpl::producer<SpellcheckChange> SpellcheckChanged();
+
 } // namespace Spellchecker
@@ -0,0 +1,150 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include <catch2/catch.hpp>
+
+#include "spellcheck/spellcheck_utils.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace Spellchecker;
+
+namespace {
+
+// The classification without the Latin-1 fast path.
+[[nodiscard]] QChar::Script ReferenceWordScript(QStringView word) {
+	for (const auto c : word) {
+		if (c.isLetter()) {
+			return c.script();
+		}
+	}
+	return QChar::Script_Common;
+}
+
+[[nodiscard]] bool ReferenceIsWordSkippable(QStringView word) {
+	const auto wordScript = ReferenceWordScript(word);
+	return ranges::any_of(word, [&](QChar c) {
+		return (c.script() != wordScript)
+			&& (c.unicode() != 769)
+			&& (c.unicode() != '\'')
+			&& (c.unicode() != '_');
+	});
+}
+
+} // namespace
+
+TEST_CASE("invoke in parallel", "[spellcheck_utils]") {
+	SECTION("nothing is invoked for zero count") {
+		auto invoked = 0;
+		InvokeInParallel(0, [&](int) { ++invoked; });
+		REQUIRE(invoked == 0);
+	}
+
+	SECTION("single index is invoked on the calling thread") {
+		auto thread = std::thread::id();
+		InvokeInParallel(1, [&](int index) {
+			REQUIRE(index == 0);
+			thread = std::this_thread::get_id();
+		});
+		REQUIRE(thread == std::this_thread::get_id());
+	}
+
+	SECTION("every index is invoked once before the return") {
+		constexpr auto kCount = 64;
+		auto invoked = std::vector<std::atomic<int>>(kCount);
+		InvokeInParallel(kCount, [&](int index) {
+			++invoked[index];
+		});
+		for (const auto &count : invoked) {
+			REQUIRE(count.load() == 1);
+		}
+	}
+
+	SECTION("nested invocations don't wait for each other") {
+		constexpr auto kCount = 16;
+		auto invoked = std::atomic<int>(0);
+		InvokeInParallel(kCount, [&](int) {
+			InvokeInParallel(kCount, [&](int) { ++invoked; });
+		});
+		REQUIRE(invoked.load() == kCount * kCount);
+	}
+}
+
+TEST_CASE("latin-1 word classification", "[spellcheck_utils]") {
+	SECTION("words of letters are not skippable") {
+		REQUIRE(WordScript(u"hello") == QChar::Script_Latin);
+		REQUIRE(!IsWordSkippable(u"hello", false));
+		REQUIRE(!IsWordSkippable(u"Straße", false));
+		REQUIRE(!IsWordSkippable(u"naïve", false));
+		REQUIRE(!IsWordSkippable(u"don't", false));
+		REQUIRE(!IsWordSkippable(u"snake_case", false));
+	}
+
+	SECTION("letters mixed with other characters are skippable") {
+		REQUIRE(IsWordSkippable(u"abc1", false));
+		REQUIRE(IsWordSkippable(u"a.b", false));
+		REQUIRE(IsWordSkippable(u"x×y", false));
+		REQUIRE(IsWordSkippable(u"5µm", false));
+	}
+
+	SECTION("words without letters are not skippable") {
+		REQUIRE(WordScript(u"1234") == QChar::Script_Common);
+		REQUIRE(!IsWordSkippable(u"1234", false));
+		REQUIRE(!IsWordSkippable(u"", false));
+	}
+
+	SECTION("words outside of Latin-1 are looked up") {
+		REQUIRE(WordScript(u"при") == QChar::Script_Cyrillic);
+		REQUIRE(!IsWordSkippable(u"при", false));
+		REQUIRE(IsWordSkippable(u"приabc", false));
+		REQUIRE(WordScript(u"1α") == QChar::Script_Greek);
+	}
+
+	SECTION("too long words are skippable") {
+		const auto word = QString(kMaxWordSize + 1, QChar('a'));
+		REQUIRE(IsWordSkippable(word, false));
+		REQUIRE(!IsWordSkippable(QStringView(word).mid(1), false));
+	}
+
+	SECTION("every latin-1 character is classified as without the tables") {
+		for (auto code = 0; code != 0x100; ++code) {
+			const auto c = QChar(code);
+			for (const auto &word : {
+					QString(c),
+					QString(c) + QChar('a'),
+					u"a"_q + c,
+					u"ab"_q + c + u"cd"_q + c,
+					u"é"_q + c + u"α"_q }) {
+				INFO("character " << code);
+				REQUIRE(WordScript(word) == ReferenceWordScript(word));
+				REQUIRE(IsWordSkippable(word, false)
+					== ReferenceIsWordSkippable(word));
+			}
+		}
+	}
+}
+
+TEST_CASE("locale to script code", "[spellcheck_utils]") {
+	REQUIRE(LocaleToScriptCode(u"en") == QChar::Script_Latin);
+	REQUIRE(LocaleToScriptCode(u"en_US") == QChar::Script_Latin);
+	REQUIRE(LocaleToScriptCode(u"pt-BR") == QChar::Script_Latin);
+	REQUIRE(LocaleToScriptCode(u"ru_RU") == QChar::Script_Cyrillic);
+	REQUIRE(LocaleToScriptCode(u"he") == QChar::Script_Hebrew);
+	REQUIRE(LocaleToScriptCode(u"ast") == QChar::Script_Latin);
+	REQUIRE(LocaleToScriptCode(u"azb") == QChar::Script_Arabic);
+	REQUIRE(LocaleToScriptCode(u"ja_JP") == QChar::Script_Katakana);
+
+	SECTION("unknown locales are of the common script") {
+		REQUIRE(LocaleToScriptCode(u"") == QChar::Script_Common);
+		REQUIRE(LocaleToScriptCode(u"_US") == QChar::Script_Common);
+		REQUIRE(LocaleToScriptCode(u"qq") == QChar::Script_Common);
+		REQUIRE(LocaleToScriptCode(u"EN") == QChar::Script_Common);
+		REQUIRE(LocaleToScriptCode(u"e1") == QChar::Script_Common);
+		REQUIRE(LocaleToScriptCode(u"engl") == QChar::Script_Common);
+		REQUIRE(LocaleToScriptCode(u"engl_US") == QChar::Script_Common);
+	}
+}
@@ -10,6 +10,9 @@
 #include "spellcheck/spellcheck_value.h"
 #include "spellcheck/spellcheck_utils.h"
 #include "spellcheck/spelling_highlighter_helper.h"
+#include "spellcheck/spelling_ranges.h"
+#include "spellcheck/spelling_schedule.h"
+#include "spellcheck/spellcheck_stats.h"
 #include "ui/qt_weak_factory.h"
 #include "ui/widgets/menu/menu.h"
 #include "ui/text/text_entity.h"
@@ -35,6 +38,13 @@ constexpr auto kColdSpellcheckingTimeout = crl::time(1000);
 
 constexpr auto kMaxDeadKeys = 1;
 
+// The text that is longer is checked by parts.
+constexpr auto kCheckChunkSize = 1024;
+
+// The blocks outside of the viewport are checked by parts of this size.
+constexpr auto kIdleCheckPartSize = 16 * 1024;
+constexpr auto kIdleCheckTimeout = crl::time(10);
+
 constexpr auto kSkippableFlags = 0
 	| TextParseLinks
 	| TextParseMentions
@@ -118,13 +128,6 @@ inline auto IntersectsAnyOfEntities(
 	});
 }
 
-inline QChar AddedSymbol(QStringView text, int position, int added) {
-	if (added != 1 || position >= text.size()) {
-		return QChar();
-	}
-	return text.at(position);
-}
-
 inline MisspelledWord CorrectAccentValues(
 		const QString &oldText,
 		const QString &newText) {
@@ -159,8 +162,89 @@ inline MisspelledWord RangeFromCursorSelection(const QTextCursor &cursor) {
 	return (e->key() == Qt::Key_Space) && e->modifiers().testFlag(modifier);
 }
 
+// Checks the text by parts, so the check can be cancelled between words.
+[[nodiscard]] bool CheckSpellingTextByParts(
+		const QString &text,
+		MisspelledWords *ranges,
+		const std::atomic<bool> &cancelled) {
+	const auto size = int(text.size());
+	auto from = 0;
+	while (from < size) {
+		if (cancelled) {
+			return false;
+		}
+		auto till = std::min(from + kCheckChunkSize, size);
+		while (till < size && !text.at(till).isSpace()) {
+			++till;
+		}
+		if (!from && till == size) {
+			Platform::Spellchecker::CheckSpellingText(text, ranges);
+			break;
+		}
+		auto part = MisspelledWords();
+		Platform::Spellchecker::CheckSpellingText(
+			text.mid(from, till - from),
+			&part);
+		for (const auto &[position, length] : part) {
+			ranges->emplace_back(from + position, length);
+		}
+		from = till;
+	}
+	return !cancelled;
+}
+
 } // namespace
 
+struct SpellingHighlighter::CheckJob {
+	// The only field that is used outside of the main thread.
+	std::atomic<bool> cancelled = false;
+
+	// The range of the document for the checks of a part of the text.
+	// It is shifted by the edits that are made while the job is pending.
+	int from = 0;
+	int till = 0;
+
+	std::vector<BlockRevision> revisions;
+
+	// Some dirty blocks were left for the next job.
+	bool more = false;
+};
+
+struct SpellingHighlighter::BlockData final : QTextBlockUserData {
+	// Relative to the block position.
+	MisspelledRanges ranges;
+
+	// The text of the block after the last known change.
+	QString text;
+
+	// Changed on each edit of the block.
+	uint64 revision = 0;
+
+	// The revision that the ranges were fully checked for.
+	uint64 checked = 0;
+
+	// Unique for each data, the same as the first revision.
+	uint64 id = 0;
+
+	// The block is in the list of dirty blocks.
+	bool dirty = false;
+};
+
+struct SpellingHighlighter::SuggestionsRequest {
+	// Fills the menu and shows it, when the word is checked.
+	FnMut<void(bool isCorrect)> fill;
+	// Adds a suggestion to the menu that is shown.
+	AddSuggestion add;
+	// Deletes the menu that was not shown.
+	Fn<void()> drop;
+	rpl::lifetime lifetime;
+
+	bool hasSuggestions = false;
+
+	// The search is finished, the request may be removed.
+	bool done = false;
+};
+
 SpellingHighlighter::SpellingHighlighter(
 	not_null<Ui::InputField*> field,
 	rpl::producer<bool> enabled,
@@ -168,6 +252,7 @@ SpellingHighlighter::SpellingHighlighter(
 : QSyntaxHighlighter(field->rawTextEdit()->document())
 , _cursor(QTextCursor(document()))
 , _coldSpellcheckingTimer([=] { checkChangedText(); })
+, _idleCheckTimer([=] { checkDirtyBlocks(); })
 , _field(field)
 , _textEdit(field->rawTextEdit())
 , _customContextMenuItem(customContextMenuItem) {
@@ -175,8 +260,6 @@ SpellingHighlighter::SpellingHighlighter(
 	Platform::Spellchecker::Init();
 #endif // !Q_OS_WIN
 
-	_cachedRanges = MisspelledWords();
-
 	// Use the patched SpellCheckUnderline style.
 	_misspelledFormat.setUnderlineStyle(QTextCharFormat::SpellCheckUnderline);
 	style::PaletteChanged(
@@ -197,18 +280,11 @@ SpellingHighlighter::SpellingHighlighter(
 		if (!IsTagUnspellcheckable(markdownTag.tag)) {
 			return;
 		}
-		_cachedRanges = ranges::views::all(
-			_cachedRanges
-		) | ranges::views::filter([&](const auto &range) {
-			return !IntersectsWordRanges(
-				range,
-				markdownTag.internalStart,
-				markdownTag.internalLength);
-		}) | ranges::to_vector;
+		removeRanges(markdownTag.internalStart, markdownTag.internalLength);
 		rehighlight();
 	}, _lifetime);
 
-	updateDocumentText();
+	_blockCount = document()->blockCount();
 
 	std::move(
 		enabled
@@ -225,9 +301,9 @@ SpellingHighlighter::SpellingHighlighter(
 		}
 	}, _lifetime);
 
-	Spellchecker::SupportedScriptsChanged(
-	) | rpl::start_with_next([=] {
-		checkCurrentText();
+	Spellchecker::SpellcheckChanged(
+	) | rpl::start_with_next([=](const SpellcheckChange &change) {
+		checkChanged(change);
 	}, _lifetime);
 }
 
@@ -240,17 +316,11 @@ void SpellingHighlighter::contentsChange(int pos, int removed, int added) {
 		return;
 	}
 	if (document()->isEmpty()) {
-		updateDocumentText();
-		_cachedRanges.clear();
+		clearRanges();
 		return;
 	}
 
 	{
-		const auto oldText = documentText().mid(
-			pos,
-			documentText().indexOf(QChar::ParagraphSeparator, pos));
-		updateDocumentText();
-
 		const auto b = findBlock(pos);
 		const auto bLen = (document()->blockCount() > 1)
 			? b.length()
@@ -263,6 +333,8 @@ void SpellingHighlighter::contentsChange(int pos, int removed, int added) {
 		// This invokes to re-check the entire text.
 		// The Mac's accent menu has a pretty similar behavior.
 		if ((b.position() == pos) && (bLen == added)) {
+			const auto data = blockData(b);
+			const auto oldText = data ? data->text : QString();
 			const auto newText = b.text();
 			const auto diff = added - removed;
 			// The plain text of the document cannot contain dead keys.
@@ -276,7 +348,7 @@ void SpellingHighlighter::contentsChange(int pos, int removed, int added) {
 					// we can clear cached ranges of misspelled words.
 					if (!c.first && c.second == bLen) {
 						if (hasUnspellcheckableTag(pos, added)) {
-							_cachedRanges.clear();
+							clearRanges();
 							rehighlight();
 						} else {
 							checkCurrentText();
@@ -295,44 +367,71 @@ void SpellingHighlighter::contentsChange(int pos, int removed, int added) {
 		}
 	}
 
-	const auto shift = [&](auto chars) {
-		ranges::for_each(_cachedRanges, [&](auto &range) {
-			if (range.first >= pos + removed) {
-				range.first += chars;
-			}
-		});
-	};
+	shiftRangeJobs(pos, removed, added);
 
-	// Shift to the right all words after the cursor, when adding text.
-	if (added > 0) {
-		shift(added);
-	}
+	const auto block = findBlock(pos);
+	const auto blockPosition = block.position();
 
-	// Remove all words that are in the selection.
-	// Remove the word that is under the cursor.
-	const auto wordUnderPos = getWordUnderPosition(pos);
+	// Only the block of the change position keeps the ranges,
+	// the blocks that were added by the change are checked from scratch.
+	const auto lastBlock = findBlock(pos + added);
+	const auto structural = (lastBlock != block)
+		|| (document()->blockCount() != _blockCount);
+	_blockCount = document()->blockCount();
 
-	// If the cursor is between spaces,
-	// QTextCursor::WordUnderCursor highlights the word on the left
-	// even if the word is not under the cursor.
-	// Example: "super  |  test", where | is the cursor position.
-	// In this example QTextCursor::WordUnderCursor will select "super".
-	const auto isPosNotInWord = pos > EndOfWord(wordUnderPos);
+	if (const auto data = blockData(block)) {
+		// Relative to the block.
+		const auto position = pos - blockPosition;
+		auto &words = data->ranges;
 
-	_cachedRanges = (
-		_cachedRanges
-	) | ranges::views::filter([&](const auto &range) {
-		const auto isIntersected = IntersectsWordRanges(range, wordUnderPos);
-		if (isIntersected) {
-			return isPosNotInWord;
+		// Shift to the right all words after the cursor, when adding text.
+		if (added > 0) {
+			words.shift(position + removed, added);
 		}
-		return !(isIntersected
-			|| (removed > 0 && IntersectsWordRanges(range, pos, removed)));
-	}) | ranges::to_vector;
 
-	// Shift to the left all words after the cursor, when deleting text.
-	if (removed > 0) {
-		shift(-removed);
+		// Remove all words that are in the selection.
+		// Remove the word that is under the cursor.
+		const auto wordUnderPos = getWordUnderPosition(pos);
+		const auto word = MisspelledWord(
+			wordUnderPos.first - blockPosition,
+			wordUnderPos.second);
+
+		// If the cursor is between spaces,
+		// QTextCursor::WordUnderCursor highlights the word on the left
+		// even if the word is not under the cursor.
+		// Example: "super  |  test", where | is the cursor position.
+		// In this example QTextCursor::WordUnderCursor will select "super".
+		const auto isPosNotInWord = pos > EndOfWord(wordUnderPos);
+
+		if (!isPosNotInWord) {
+			words.remove(word.first, word.second);
+		}
+
+		// Shift to the left all words after the cursor, when deleting text.
+		if (removed > 0) {
+			words.remove(position, removed);
+			words.shift(position + removed, -removed);
+		}
+
+		// The words that were moved to the next block by the change.
+		words.truncate(block.length());
+	}
+
+	auto touched = std::vector<QTextBlock>();
+	for (auto b = block; b.isValid(); b = b.next()) {
+		if (b != block) {
+			ensureBlockData(b)->ranges.clear();
+		}
+		touchBlock(b);
+		touched.push_back(b);
+		if (b == lastBlock) {
+			break;
+		}
+	}
+	if (structural) {
+		// The blocks were split or merged,
+		// so the words in them can't be restored from the old ranges.
+		checkBlocks(std::move(touched));
 	}
 
 	// Normally we should to invoke rehighlighting to immediately apply
@@ -350,7 +449,9 @@ void SpellingHighlighter::contentsChange(int pos, int removed, int added) {
 		_lastPosition = pos;
 	}
 
-	const auto addedSymbol = AddedSymbol(documentText(), pos, added);
+	const auto addedSymbol = (added == 1)
+		? document()->characterAt(pos)
+		: QChar();
 
 	if ((removed == 1) || addedSymbol.isLetterOrNumber()) {
 		if (_coldSpellcheckingTimer.isActive()) {
@@ -393,12 +494,6 @@ void SpellingHighlighter::checkChangedText() {
 		return;
 	}
 
-	const auto wordInCacheIt = [=] {
-		return ranges::find_if(_cachedRanges, [&](auto &&w) {
-			return w.first >= wordUnderCursor.first;
-		});
-	};
-
 	if (added > 0) {
 		const auto lastWordNewSelection = getWordUnderPosition(pos + added);
 
@@ -411,13 +506,9 @@ void SpellingHighlighter::checkChangedText() {
 		const auto beginNewSelection = wordUnderCursor.first;
 		const auto endNewSelection = EndOfWord(lastWordNewSelection);
 
-		auto callback = [=](MisspelledWords &&r) {
-			ranges::insert(_cachedRanges, wordInCacheIt(), std::move(r));
-		};
 		invokeCheckText(
 			beginNewSelection,
-			endNewSelection - beginNewSelection,
-			std::move(callback));
+			endNewSelection - beginNewSelection);
 		return;
 	}
 
@@ -427,13 +518,16 @@ void SpellingHighlighter::checkChangedText() {
 }
 
 MisspelledWords SpellingHighlighter::filterSkippableWords(
-		MisspelledWords &ranges) {
-	const auto text = documentText();
-	if (text.isEmpty()) {
-		return MisspelledWords();
-	}
+		const MisspelledWords &ranges,
+		QStringView text,
+		int textPosition) {
+	// The ranges are relative to the text that was checked.
 	return ranges | ranges::views::filter([&](const auto &range) {
-		return !isSkippableWord(range);
+		if (hasUnspellcheckableTag(textPosition + range.first, range.second)) {
+			return false;
+		}
+		const auto ref = base::StringViewMid(text, range.first, range.second);
+		return !ref.isNull() && !IsWordSkippable(ref);
 	}) | ranges::to_vector;
 }
 
@@ -445,8 +539,12 @@ bool SpellingHighlighter::isSkippableWord(int position, int length) {
 	if (hasUnspellcheckableTag(position, length)) {
 		return true;
 	}
-	const auto text = documentText();
-	const auto ref = base::StringViewMid(text, position, length);
+	const auto block = findBlock(position);
+	const auto text = block.text();
+	const auto ref = base::StringViewMid(
+		text,
+		position - block.position(),
+		length);
 	if (ref.isNull()) {
 		return true;
 	}
@@ -455,56 +553,263 @@ bool SpellingHighlighter::isSkippableWord(int position, int length) {
 
 void SpellingHighlighter::checkCurrentText() {
 	if (document()->isEmpty()) {
-		_cachedRanges.clear();
+		clearRanges();
+		return;
+	}
+	auto blocks = std::vector<QTextBlock>();
+	blocks.reserve(document()->blockCount());
+	for (auto b = document()->begin(); b != document()->end(); b = b.next()) {
+		blocks.push_back(b);
+	}
+	checkBlocks(std::move(blocks));
+}
+
+void SpellingHighlighter::checkChanged(const SpellcheckChange &change) {
+	if (change.all) {
+		checkCurrentText();
 		return;
 	}
-	invokeCheckText(0, size(), [&](MisspelledWords &&ranges) {
-		_cachedRanges = std::move(ranges);
+	// Only the blocks that may have other verdicts are checked again,
+	// they go along with the dirty blocks, visible ones first.
+	const auto affected = [&](const QString &text) {
+		return ranges::any_of(change.words, [&](const QString &word) {
+			return text.contains(word);
+		}) || (!change.scripts.empty() && ranges::any_of(text, [&](QChar c) {
+			return ranges::contains(change.scripts, c.script());
+		}));
+	};
+	auto blocks = std::vector<QTextBlock>();
+	for (auto b = document()->begin(); b != document()->end(); b = b.next()) {
+		if (affected(b.text())) {
+			blocks.push_back(b);
+		}
+	}
+	if (!blocks.empty()) {
+		checkBlocks(std::move(blocks));
+	}
+}
+
+void SpellingHighlighter::checkBlocks(std::vector<QTextBlock> blocks) {
+	// The forced blocks are checked along with the other dirty blocks,
+	// so all pending checks of blocks are merged into one job.
+	for (const auto &block : blocks) {
+		if (block.isValid()) {
+			const auto data = ensureBlockData(block);
+			data->checked = 0;
+			markDirty(block, data);
+		}
+	}
+	checkDirtyBlocks();
+}
+
+void SpellingHighlighter::checkDirtyBlocks() {
+	if (!_enabled) {
+		return;
+	}
+	_idleCheckTimer.cancel();
+
+	// The blocks that were removed or checked since are forgotten.
+	auto dirtyBlocks = std::vector<QTextBlock>();
+	dirtyBlocks.reserve(_dirtyBlocks.size());
+	for (const auto &[block, id] : base::take(_dirtyBlocks)) {
+		const auto data = block.isValid() ? blockData(block) : nullptr;
+		if (!data || (data->id != id)) {
+			continue;
+		} else if (data->checked == data->revision) {
+			data->dirty = false;
+			continue;
+		} else if (block.length() <= 1) {
+			data->dirty = false;
+			data->ranges.clear();
+			data->checked = data->revision;
+			continue;
+		}
+		_dirtyBlocks.emplace_back(block, id);
+		dirtyBlocks.push_back(block);
+	}
+	ranges::sort(dirtyBlocks, ranges::less(), &QTextBlock::position);
+	auto dirty = std::vector<DirtyBlock>();
+	dirty.reserve(dirtyBlocks.size());
+	for (const auto &block : dirtyBlocks) {
+		dirty.push_back({ block.blockNumber(), block.length() });
+	}
+	const auto [firstVisible, lastVisible] = visibleBlocks();
+	const auto schedule = ScheduleDirtyBlocks(
+		dirty,
+		firstVisible,
+		lastVisible,
+		kIdleCheckPartSize);
+
+	struct Part {
+		QTextBlock block;
+		uint64 revision = 0;
+		QString text;
+		MisspelledWords ranges;
+	};
+	auto parts = std::vector<Part>();
+	auto revisions = std::vector<BlockRevision>();
+	parts.reserve(schedule.indices.size());
+	revisions.reserve(schedule.indices.size());
+	for (const auto index : schedule.indices) {
+		const auto &block = dirtyBlocks[index];
+		const auto revision = blockData(block)->revision;
+		revisions.push_back({ block, revision });
+		parts.push_back({ block, revision, block.text() });
+	}
+	if (_blocksJob) {
+		if (_blocksJob->revisions == revisions) {
+			// The job that is running already checks the same text.
+			return;
+		}
+		_blocksJob->cancelled = true;
+		_blocksJob = nullptr;
+	}
+	if (parts.empty()) {
+		return;
+	}
+
+	const auto job = std::make_shared<CheckJob>();
+	job->revisions = std::move(revisions);
+	job->more = schedule.more;
+	_blocksJob = job;
+
+	const auto weak = Ui::MakeWeak(this);
+	crl::async([=, parts = std::move(parts)]() mutable {
+		for (auto &part : parts) {
+			const auto checked = CheckSpellingTextByParts(
+				part.text,
+				&part.ranges,
+				job->cancelled);
+			if (!checked) {
+				return;
+			}
+		}
+		crl::on_main(weak, [=, parts = std::move(parts)]() mutable {
+			if (_blocksJob != job) {
+				return;
+			}
+			_blocksJob = nullptr;
+			auto outdated = false;
+			for (auto &part : parts) {
+				// The block was changed during async work,
+				// it will be checked again.
+				const auto data = blockData(part.block);
+				if (!data || (data->revision != part.revision)) {
+					outdated = true;
+					continue;
+				}
+				data->ranges.assign(filterSkippableWords(
+					part.ranges,
+					part.text,
+					part.block.position()));
+				data->checked = part.revision;
+				rehighlightBlock(part.block);
+			}
+			// Yield to the event loop between the parts of the document.
+			if (job->more || (outdated && _rangeJobs.empty())) {
+				_idleCheckTimer.callOnce(kIdleCheckTimeout);
+			}
+		});
 	});
 }
 
-void SpellingHighlighter::invokeCheckText(
-		int textPosition,
-		int textLength,
-		Fn<void(MisspelledWords &&ranges)> callback) {
+void SpellingHighlighter::shiftRangeJobs(int pos, int removed, int added) {
+	// The pending ranges follow the text, as the misspelled ranges do,
+	// so a merge with them doesn't skip the text that was typed since.
+	const auto shift = [&](int position) {
+		return (position >= pos + removed)
+			? (position - removed + added)
+			: std::min(position, pos);
+	};
+	for (const auto &job : _rangeJobs) {
+		job->from = shift(job->from);
+		job->till = (job->till >= pos)
+			? std::max(shift(job->till), pos + added)
+			: job->till;
+	}
+}
+
+std::pair<int, int> SpellingHighlighter::visibleBlocks() const {
+	const auto viewport = _textEdit->viewport();
+	if (!viewport->isVisible()) {
+		return { -1, -1 };
+	}
+	const auto rect = viewport->rect();
+	return {
+		_textEdit->cursorForPosition(rect.topLeft()).blockNumber(),
+		_textEdit->cursorForPosition(rect.bottomRight()).blockNumber(),
+	};
+}
+
+void SpellingHighlighter::invokeCheckText(int textPosition, int textLength) {
 	if (!_enabled) {
 		return;
 	}
 
-	const auto rangesOffset = textPosition;
-	const auto text = partDocumentText(textPosition, textLength);
+	// The pending checks that overlap the new one are superseded by it.
+	auto from = textPosition;
+	auto till = textPosition + textLength;
+	for (auto i = begin(_rangeJobs); i != end(_rangeJobs);) {
+		const auto &pending = *i;
+		if (pending->from <= till && from <= pending->till) {
+			from = std::min(from, pending->from);
+			till = std::max(till, pending->till);
+			pending->cancelled = true;
+			Count(Counter::CheckJobsDiscarded);
+			i = _rangeJobs.erase(i);
+		} else {
+			++i;
+		}
+	}
+	till = std::min(till, size());
+	if (from >= till) {
+		return;
+	}
+
+	const auto job = std::make_shared<CheckJob>();
+	job->from = from;
+	job->till = till;
+	job->revisions = blockRevisions(from, till - from);
+	_rangeJobs.push_back(job);
+	Count(Counter::CheckJobsStarted);
+
+	const auto text = partDocumentText(from, till - from);
 	const auto weak = Ui::MakeWeak(this);
-	_countOfCheckingTextAsync++;
-	crl::async([=,
-		text = std::move(text),
-		callback = std::move(callback)]() mutable {
+	crl::async([=, text = std::move(text)]() mutable {
 		MisspelledWords misspelledWordRanges;
-		Platform::Spellchecker::CheckSpellingText(
+		const auto checked = CheckSpellingTextByParts(
 			text,
-			&misspelledWordRanges);
-		if (rangesOffset) {
-			ranges::for_each(misspelledWordRanges, [&](auto &&range) {
-				range.first += rangesOffset;
-			});
+			&misspelledWordRanges,
+			job->cancelled);
+		if (!checked) {
+			return;
 		}
 		crl::on_main(weak, [=,
 				text = std::move(text),
-				ranges = std::move(misspelledWordRanges),
-				callback = std::move(callback)]() mutable {
-			_countOfCheckingTextAsync--;
+				ranges = std::move(misspelledWordRanges)]() mutable {
+			const auto i = ranges::find(_rangeJobs, job);
+			if (i == end(_rangeJobs)) {
+				return;
+			}
+			_rangeJobs.erase(i);
+
 			// Checking a large part of text can take an unknown amount of
-			// time. So we have to compare the text before and after async
-			// work.
+			// time. So we have to compare the revisions of the blocks
+			// before and after async work.
 			// If the text has changed during async and we have more async,
 			// we don't perform further refreshing of cache and underlines.
 			// But if it was the last async, we should invoke a new one.
-			if (compareDocumentText(text, textPosition, textLength)) {
-				if (!_countOfCheckingTextAsync) {
-					checkCurrentText();
+			if (!actualRevisions(job->revisions)) {
+				Count(Counter::CheckJobsDiscarded);
+				if (_rangeJobs.empty() && !_blocksJob) {
+					checkDirtyBlocks();
 				}
 				return;
 			}
-			auto filtered = filterSkippableWords(ranges);
+			auto filtered = filterSkippableWords(ranges, text, job->from);
+			for (auto &range : filtered) {
+				range.first += job->from;
+			}
 
 			// When we finish checking the text, the user can
 			// supplement the last word and there may be a situation where
@@ -523,20 +828,41 @@ void SpellingHighlighter::invokeCheckText(
 			// We can fix it with a check of completeness of the last word.
 			if (filtered.size()) {
 				const auto lastWord = filtered.back();
-				if (const auto endOfText = textPosition + textLength;
-					EndOfWord(lastWord) == endOfText) {
-					const auto word = getWordUnderPosition(endOfText);
-					if (EndOfWord(word) != endOfText) {
+				if (EndOfWord(lastWord) == job->till) {
+					const auto word = getWordUnderPosition(job->till);
+					if (EndOfWord(word) != job->till) {
 						filtered.pop_back();
 						checkSingleWord(word);
 					}
 				}
 			}
 
-			callback(std::move(filtered));
-			for (const auto &b : blocksFromRange(textPosition, textLength)) {
+			// The blocks that were checked entirely are not dirty anymore.
+			const auto length = job->till - job->from;
+			const auto blocks = blocksFromRange(job->from, length);
+			for (const auto &b : blocks) {
+				const auto data = blockData(b);
+				if (data
+					&& (b.position() >= job->from)
+					&& (b.position() + b.length() - 1 <= job->till)) {
+					data->ranges.clear();
+					data->checked = data->revision;
+				}
+			}
+			addRanges(filtered);
+			for (const auto &b : blocks) {
 				rehighlightBlock(b);
 			}
+
+			// The context menu will likely be asked for these words.
+			if (!filtered.empty()) {
+				Platform::Spellchecker::PrefetchSuggestions(ranges::views::all(
+					filtered
+				) | ranges::views::reverse | ranges::views::transform([&](
+						const auto &range) {
+					return text.mid(range.first - job->from, range.second);
+				}) | ranges::to_vector);
+			}
 		});
 	});
 }
@@ -547,6 +873,9 @@ void SpellingHighlighter::checkSingleWord(const MisspelledWord &singleWord) {
 	if (isSkippableWord(singleWord)) {
 		return;
 	}
+	const auto revisions = blockRevisions(
+		singleWord.first,
+		singleWord.second);
 	crl::async([=,
 		w = std::move(w),
 		singleWord = std::move(singleWord)]() mutable {
@@ -556,14 +885,11 @@ void SpellingHighlighter::checkSingleWord(const MisspelledWord &singleWord) {
 
 		crl::on_main(weak, [=,
 				singleWord = std::move(singleWord)]() mutable {
-			const auto posOfWord = singleWord.first;
-			ranges::insert(
-				_cachedRanges,
-				ranges::find_if(_cachedRanges, [&](auto &&w) {
-					return w.first >= posOfWord;
-				}),
-				singleWord);
-			rehighlightBlock(findBlock(posOfWord));
+			if (!actualRevisions(revisions)) {
+				return;
+			}
+			addRanges({ singleWord });
+			rehighlightBlock(findBlock(singleWord.first));
 		});
 	});
 }
@@ -603,23 +929,19 @@ MisspelledWord SpellingHighlighter::getWordUnderPosition(int position) {
 }
 
 void SpellingHighlighter::highlightBlock(const QString &text) {
-	if (_cachedRanges.empty() || !_enabled || text.isEmpty()) {
+	if (!_enabled || text.isEmpty()) {
+		return;
+	}
+	const auto data = blockData(currentBlock());
+	if (!data || data->ranges.empty()) {
 		return;
 	}
 	const auto entities = FindEntities(text);
-	const auto bPos = currentBlock().position();
-	const auto bLen = currentBlock().length();
-	ranges::for_each((
-		_cachedRanges
-	// Skip the all words outside the current block.
-	) | ranges::views::filter([&](const auto &range) {
-		return IntersectsWordRanges(range, bPos, bLen);
-	}), [&](const auto &range) {
-		const auto posInBlock = range.first - bPos;
-		if (IntersectsAnyOfEntities(posInBlock, range.second, entities)) {
+	data->ranges.enumerate(0, text.size(), [&](MisspelledWord range) {
+		if (IntersectsAnyOfEntities(range.first, range.second, entities)) {
 			return;
 		}
-		setFormat(posInBlock, range.second, _misspelledFormat);
+		setFormat(range.first, range.second, _misspelledFormat);
 	});
 
 	setCurrentBlockState(0);
@@ -663,7 +985,7 @@ bool SpellingHighlighter::eventFilter(QObject *o, QEvent *e) {
 		const auto k = static_cast<QKeyEvent*>(e);
 		if (ranges::contains(kKeysToCheck, k->key())) {
 			if (_addedSymbols + _removedSymbols + _lastPosition) {
-				checkCurrentText();
+				checkDirtyBlocks();
 			}
 		} else if ((o == _textEdit) && k->isAutoRepeat()) {
 			_isLastKeyRepeat = true;
@@ -672,7 +994,7 @@ bool SpellingHighlighter::eventFilter(QObject *o, QEvent *e) {
 		if (e->type() == QEvent::FocusOut) {
 			_isLastKeyRepeat = false;
 			if (_addedSymbols + _removedSymbols + _lastPosition) {
-				checkCurrentText();
+				checkDirtyBlocks();
 			}
 		} else if (e->type() == QEvent::KeyRelease) {
 			const auto k = static_cast<QKeyEvent*>(e);
@@ -684,7 +1006,7 @@ bool SpellingHighlighter::eventFilter(QObject *o, QEvent *e) {
 	} else if ((o == _textEdit->viewport())
 			&& (e->type() == QEvent::MouseButtonPress)) {
 		if (_addedSymbols + _removedSymbols + _lastPosition) {
-			checkCurrentText();
+			checkDirtyBlocks();
 		}
 	}
 	return false;
@@ -697,24 +1019,112 @@ bool SpellingHighlighter::enabled() {
 void SpellingHighlighter::setEnabled(bool enabled) {
 	_enabled = enabled;
 	if (_enabled) {
-		updateDocumentText();
+		_blockCount = document()->blockCount();
 		checkCurrentText();
 	} else {
-		_cachedRanges.clear();
+		_idleCheckTimer.cancel();
+		if (const auto job = base::take(_blocksJob)) {
+			job->cancelled = true;
+		}
+		for (const auto &job : base::take(_rangeJobs)) {
+			job->cancelled = true;
+		}
+		clearRanges();
 		rehighlight();
 	}
 }
 
-QString SpellingHighlighter::documentText() {
-	return _lastPlainText;
+QString SpellingHighlighter::partDocumentText(int pos, int length) {
+	// The selected text has the same paragraph separators as the raw text.
+	_cursor.setPosition(std::min(pos, size()));
+	_cursor.setPosition(
+		std::min(pos + length, size()),
+		QTextCursor::KeepAnchor);
+	return _cursor.selectedText();
 }
 
-void SpellingHighlighter::updateDocumentText() {
-	_lastPlainText = document()->toRawText();
+auto SpellingHighlighter::blockData(const QTextBlock &block) const
+-> BlockData* {
+	return dynamic_cast<BlockData*>(block.userData());
 }
 
-QString SpellingHighlighter::partDocumentText(int pos, int length) {
-	return _lastPlainText.mid(pos, length);
+auto SpellingHighlighter::ensureBlockData(QTextBlock block)
+-> not_null<BlockData*> {
+	if (const auto data = blockData(block)) {
+		return data;
+	}
+	const auto data = new BlockData();
+	data->text = block.text();
+	data->revision = data->id = ++_revision;
+
+	// The document takes the ownership.
+	block.setUserData(data);
+	markDirty(block, data);
+	return data;
+}
+
+void SpellingHighlighter::touchBlock(QTextBlock block) {
+	const auto data = ensureBlockData(block);
+	data->text = block.text();
+	data->revision = ++_revision;
+	markDirty(block, data);
+}
+
+void SpellingHighlighter::markDirty(
+		QTextBlock block,
+		not_null<BlockData*> data) {
+	if (!data->dirty) {
+		data->dirty = true;
+		_dirtyBlocks.emplace_back(block, data->id);
+	}
+}
+
+auto SpellingHighlighter::blockRevisions(int pos, int length)
+-> std::vector<BlockRevision> {
+	return ranges::views::all(
+		blocksFromRange(pos, length)
+	) | ranges::views::transform([&](const QTextBlock &block) {
+		return BlockRevision{ block, ensureBlockData(block)->revision };
+	}) | ranges::to_vector;
+}
+
+bool SpellingHighlighter::actualRevisions(
+		const std::vector<BlockRevision> &revisions) const {
+	// The revisions are unique, so a block that was removed
+	// can't be confused with another block that took its place.
+	return ranges::all_of(revisions, [&](const BlockRevision &revision) {
+		const auto data = blockData(revision.block);
+		return data && (data->revision == revision.revision);
+	});
+}
+
+void SpellingHighlighter::addRanges(const MisspelledWords &ranges) {
+	for (const auto &range : ranges) {
+		const auto block = findBlock(range.first);
+		if (!block.isValid()) {
+			continue;
+		}
+		ensureBlockData(block)->ranges.insert({
+			range.first - block.position(),
+			range.second,
+		});
+	}
+}
+
+void SpellingHighlighter::removeRanges(int pos, int length) {
+	for (const auto &block : blocksFromRange(pos, length)) {
+		if (const auto data = blockData(block)) {
+			data->ranges.remove(pos - block.position(), length);
+		}
+	}
+}
+
+void SpellingHighlighter::clearRanges() {
+	for (auto b = document()->begin(); b != document()->end(); b = b.next()) {
+		if (const auto data = blockData(b)) {
+			data->ranges.clear();
+		}
+	}
 }
 
 int SpellingHighlighter::size() {
@@ -739,20 +1149,6 @@ std::vector<QTextBlock> SpellingHighlighter::blocksFromRange(
 	return blocks;
 }
 
-int SpellingHighlighter::compareDocumentText(
-		const QString &text,
-		int textPos,
-		int textLen) {
-	if (_lastPlainText.size() < textPos + textLen) {
-		return -1;
-	}
-	const auto p = base::StringViewMid(_lastPlainText, textPos, textLen);
-	if (p.isNull()) {
-		return -1;
-	}
-	return text.compare(p, Qt::CaseSensitive);
-}
-
 void SpellingHighlighter::addSpellcheckerActions(
 		not_null<QMenu*> parentMenu,
 		QTextCursor cursorForPosition,
@@ -762,7 +1158,7 @@ void SpellingHighlighter::addSpellcheckerActions(
 		ph::lng_spellchecker_submenu(ph::now),
 		parentMenu);
 
-	auto addToParentAndShow = [=](int) {
+	auto addToParentAndShow = [=] {
 		if (!menu->isEmpty()) {
 			using namespace Spelling::Helper;
 			if (IsContextMenuTop(parentMenu, mousePosition)) {
@@ -776,7 +1172,34 @@ void SpellingHighlighter::addSpellcheckerActions(
 		}
 		showMenuCallback();
 	};
-	fillSpellcheckerMenu(menu, cursorForPosition, addToParentAndShow);
+
+	// The menu may be closed and deleted before the suggestions are found.
+	const auto weakMenu = Ui::MakeWeak(menu);
+	auto addSuggestion = [=](
+			const QString &suggestion,
+			Fn<void()> replace,
+			bool first) {
+		if (const auto strong = weakMenu.data()) {
+			if (first) {
+				strong->addSeparator();
+			}
+			strong->addAction(suggestion, std::move(replace));
+		}
+	};
+
+	// The menu is deleted if the request is replaced before it is shown.
+	const auto weak = Ui::MakeWeak(parentMenu.get());
+	auto drop = [=] {
+		if (const auto strong = weak.data()) {
+			strong->deleteLater();
+		}
+	};
+	fillSpellcheckerMenu(
+		menu,
+		cursorForPosition,
+		std::move(addToParentAndShow),
+		std::move(addSuggestion),
+		std::move(drop));
 }
 
 void SpellingHighlighter::showSpellcheckerMenu() {
@@ -786,7 +1209,7 @@ void SpellingHighlighter::showSpellcheckerMenu() {
 	const auto cursor = _textEdit->textCursor();
 	auto rect = _textEdit->cursorRect(cursor);
 	rect.setTopLeft(_textEdit->viewport()->mapToGlobal(rect.topLeft()));
-	auto show = [=, menu = std::move(menu)](int firstSuggestion) mutable {
+	auto show = [=, menu = std::move(menu)]() mutable {
 		if (!menu->isEmpty()) {
 			_menu = base::make_unique_q<Ui::PopupMenu>(
 				_textEdit,
@@ -809,18 +1232,39 @@ void SpellingHighlighter::showSpellcheckerMenu() {
 				return base::EventFilterResult::Continue;
 			});
 			_menu->popup(rect.topLeft());
-			if (_menu && firstSuggestion >= 0) {
-				_menu->menu()->setSelected(firstSuggestion, false);
-			}
 		}
 	};
-	fillSpellcheckerMenu(raw, cursor, std::move(show));
+
+	// The menu is already shown, so the suggestions are added to it.
+	auto addSuggestion = [=](
+			const QString &suggestion,
+			Fn<void()> replace,
+			bool first) {
+		if (!_menu) {
+			return;
+		}
+		if (first) {
+			_menu->addSeparator();
+		}
+		const auto index = int(_menu->menu()->actions().size());
+		_menu->addAction(suggestion, std::move(replace));
+		if (first) {
+			_menu->menu()->setSelected(index, false);
+		}
+	};
+	fillSpellcheckerMenu(
+		raw,
+		cursor,
+		std::move(show),
+		std::move(addSuggestion));
 }
 
 void SpellingHighlighter::fillSpellcheckerMenu(
 		not_null<QMenu*> menu,
 		QTextCursor cursorForPosition,
-		FnMut<void(int firstSuggestionIndex)> show) {
+		FnMut<void()> show,
+		AddSuggestion addSuggestion,
+		Fn<void()> drop) {
 	const auto customItem = !Platform::Spellchecker::IsSystemSpellchecker()
 		&& _customContextMenuItem.has_value();
 
@@ -842,7 +1286,7 @@ void SpellingHighlighter::fillSpellcheckerMenu(
 	}
 
 	if (skippable) {
-		show(-1);
+		show();
 		return;
 	}
 
@@ -852,13 +1296,9 @@ void SpellingHighlighter::fillSpellcheckerMenu(
 		=,
 		show = std::move(show),
 		menu = std::move(menu)
-	](
-			bool isCorrect,
-			const auto &suggestions,
-			const auto &newTextCursor) mutable {
-		auto firstSuggestionIndex = -1;
+	](bool isCorrect) mutable {
 		const auto guard = gsl::finally([&] {
-			show(firstSuggestionIndex);
+			show();
 		});
 
 		const auto addSeparator = [&] {
@@ -872,7 +1312,7 @@ void SpellingHighlighter::fillSpellcheckerMenu(
 				addSeparator();
 				auto remove = [=] {
 					Platform::Spellchecker::RemoveWord(word);
-					checkCurrentText();
+					NotifyWordsChanged({ word });
 				};
 				menu->addAction(
 					ph::lng_spellchecker_remove(ph::now),
@@ -885,58 +1325,83 @@ void SpellingHighlighter::fillSpellcheckerMenu(
 
 		auto add = [=] {
 			Platform::Spellchecker::AddWord(word);
-			checkCurrentText();
+			NotifyWordsChanged({ word });
 		};
 		menu->addAction(ph::lng_spellchecker_add(ph::now), std::move(add));
 
 		auto ignore = [=] {
 			Platform::Spellchecker::IgnoreWord(word);
-			checkCurrentText();
+			NotifyWordsChanged({ word });
 		};
 		menu->addAction(
 			ph::lng_spellchecker_ignore(ph::now),
 			std::move(ignore));
+	};
 
-		if (suggestions.empty()) {
-			return;
-		}
-
-		addSeparator();
-		for (const auto &suggestion : suggestions) {
-			if (firstSuggestionIndex < 0) {
-				firstSuggestionIndex = menu->actions().size();
+	// A menu of the previous request is not needed anymore,
+	// but its search is finished in background to fill the cache.
+	for (const auto &request : _suggestionsRequests) {
+		request->add = nullptr;
+		if (request->fill) {
+			request->fill = nullptr;
+			if (const auto drop = base::take(request->drop)) {
+				drop();
 			}
-			auto replaceWord = [=] {
-				const auto oldTextCursor = _textEdit->textCursor();
-				_textEdit->setTextCursor(newTextCursor);
-				_textEdit->textCursor().insertText(suggestion);
-				_textEdit->setTextCursor(oldTextCursor);
-			};
-			menu->addAction(suggestion, std::move(replaceWord));
 		}
-	};
-
+	}
+	_suggestionsRequests.erase(
+		ranges::remove_if(_suggestionsRequests, &SuggestionsRequest::done),
+		end(_suggestionsRequests));
+
+	const auto request = std::make_shared<SuggestionsRequest>();
+	request->fill = std::move(fillMenu);
+	request->add = std::move(addSuggestion);
+	request->drop = std::move(drop);
+	_suggestionsRequests.push_back(request);
+
+	// The subscription is owned by the request itself.
+	const auto raw = request.get();
 	const auto weak = Ui::MakeWeak(this);
-	crl::async([=,
-		newTextCursor = std::move(cursorForPosition),
-		fillMenu = std::move(fillMenu),
-		word = std::move(word)
-	]() mutable {
+	crl::async([=, weakRequest = std::weak_ptr(request)] {
 		const auto isCorrect = Platform::Spellchecker::CheckSpelling(word);
-		auto suggestions = std::vector<QString>();
-		if (!isCorrect) {
-			Platform::Spellchecker::FillSuggestionList(word, &suggestions);
-		}
-
-		crl::on_main(weak, [=,
-			newTextCursor = std::move(newTextCursor),
-			suggestions = std::move(suggestions),
-			fillMenu = std::move(fillMenu)
-		]() mutable {
-			fillMenu(
-				isCorrect,
-				std::move(suggestions),
-				std::move(newTextCursor));
+		crl::on_main(weak, [=] {
+			const auto strong = weakRequest.lock();
+			if (!strong) {
+				return;
+			}
+			auto fill = base::take(strong->fill);
+			if (!fill) {
+				strong->done = true;
+				return;
+			}
+			// The menu is shown at once, the suggestions follow it.
+			strong->drop = nullptr;
+			fill(isCorrect);
+			if (isCorrect) {
+				strong->done = true;
+				return;
+			}
+			Suggestions(
+				word
+			) | rpl::start_with_next_done([=](std::vector<QString> &&part) {
+				if (!raw->add) {
+					return;
+				}
+				for (const auto &suggestion : part) {
+					auto replaceWord = [=] {
+						const auto oldTextCursor = _textEdit->textCursor();
+						_textEdit->setTextCursor(cursorForPosition);
+						_textEdit->textCursor().insertText(suggestion);
+						_textEdit->setTextCursor(oldTextCursor);
+					};
+					const auto first = !std::exchange(
+						raw->hasSuggestions,
+						true);
+					raw->add(suggestion, std::move(replaceWord), first);
+				}
+			}, [=] {
+				raw->done = true;
+			}, strong->lifetime);
 		});
 	});
 }
@@ -58,10 +58,18 @@ public:
 		Fn<void()> showMenuCallback,
 		QPoint mousePosition);
 
+	// The menu is shown as soon as the word is checked,
+	// the suggestions are added to it as they are found.
+	using AddSuggestion = Fn<void(
+		const QString &suggestion,
+		Fn<void()> replace,
+		bool first)>;
 	void fillSpellcheckerMenu(
 		not_null<QMenu*> menu,
 		QTextCursor cursorForPosition,
-		FnMut<void(int firstSuggestionIndex)> show);
+		FnMut<void()> show,
+		AddSuggestion addSuggestion,
+		Fn<void()> drop = nullptr);
 
 protected:
 	void highlightBlock(const QString &text) override;
@@ -73,37 +81,67 @@ private:
 	void checkText(const QString &text);
 	void showSpellcheckerMenu();
 
-	void invokeCheckText(
-		int textPosition,
-		int textLength,
-		Fn<void(MisspelledWords &&ranges)> callback);
+	void invokeCheckText(int textPosition, int textLength);
+	void shiftRangeJobs(int pos, int removed, int added);
 
 	void checkChangedText();
 	void checkSingleWord(const MisspelledWord &singleWord);
-	MisspelledWords filterSkippableWords(MisspelledWords &ranges);
+	void checkChanged(const SpellcheckChange &change);
+	void checkBlocks(std::vector<QTextBlock> blocks);
+	void checkDirtyBlocks();
+	std::pair<int, int> visibleBlocks() const;
+	MisspelledWords filterSkippableWords(
+		const MisspelledWords &ranges,
+		QStringView text,
+		int textPosition);
 	bool isSkippableWord(const MisspelledWord &range);
 	bool isSkippableWord(int position, int length);
 
 	bool hasUnspellcheckableTag(int begin, int length);
 	MisspelledWord getWordUnderPosition(int position);
 
-	QString documentText();
-	void updateDocumentText();
+	// Every block keeps its own misspelled ranges,
+	// so an edit touches only the blocks it was made in.
+	struct BlockData;
+	struct BlockRevision {
+		QTextBlock block;
+		uint64 revision = 0;
+
+		friend inline bool operator==(
+			const BlockRevision &a,
+			const BlockRevision &b) = default;
+	};
+	BlockData *blockData(const QTextBlock &block) const;
+	not_null<BlockData*> ensureBlockData(QTextBlock block);
+	void touchBlock(QTextBlock block);
+	void markDirty(QTextBlock block, not_null<BlockData*> data);
+	std::vector<BlockRevision> blockRevisions(int pos, int length);
+	bool actualRevisions(const std::vector<BlockRevision> &revisions) const;
+	void addRanges(const MisspelledWords &ranges);
+	void removeRanges(int pos, int length);
+	void clearRanges();
+
 	QString partDocumentText(int pos, int length);
-	int compareDocumentText(const QString &text, int textPos, int textLen);
-	QString _lastPlainText;
 
 	std::vector<QTextBlock> blocksFromRange(int pos, int length);
 
 	int size();
 	QTextBlock findBlock(int pos);
 
-	int _countOfCheckingTextAsync = 0;
+	// Superseded checks are cancelled, overlapping checks are merged.
+	struct CheckJob;
+	std::vector<std::shared_ptr<CheckJob>> _rangeJobs;
+	std::shared_ptr<CheckJob> _blocksJob;
+	uint64 _revision = 0;
+
+	// Only these blocks are walked by the idle check, the id of the data
+	// guards against a block that took the place of a removed one.
+	std::vector<std::pair<QTextBlock, uint64>> _dirtyBlocks;
+	int _blockCount = 0;
 
 	QTextCharFormat _misspelledFormat;
 	QTextCursor _cursor;
 
-	MisspelledWords _cachedRanges;
 	EntitiesInText _cachedSkippableEntities;
 
 	int _addedSymbols = 0;
@@ -114,6 +152,11 @@ private:
 	bool _isLastKeyRepeat = false;
 
 	base::Timer _coldSpellcheckingTimer;
+	base::Timer _idleCheckTimer;
+
+	// Every menu has its own request, the replaced ones are not shown.
+	struct SuggestionsRequest;
+	std::vector<std::shared_ptr<SuggestionsRequest>> _suggestionsRequests;
 
 	not_null<Ui::InputField*> _field;
 	not_null<QTextEdit*> _textEdit;
@@ -0,0 +1,198 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "spellcheck/spelling_ranges.h"
+
+namespace Spellchecker {
+namespace {
+
+constexpr auto kSeed = uint32(0x9E3779B9);
+
+// Xorshift is good enough for the priorities of the treap.
+[[nodiscard]] uint32 NextPriority(uint32 &seed) {
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+} // namespace
+
+MisspelledRanges::MisspelledRanges()
+: _seed(kSeed) {
+}
+
+MisspelledRanges::MisspelledRanges(MisspelledRanges &&other) noexcept
+: _root(std::move(other._root))
+, _size(std::exchange(other._size, 0))
+, _seed(other._seed) {
+}
+
+MisspelledRanges &MisspelledRanges::operator=(
+		MisspelledRanges &&other) noexcept {
+	if (this != &other) {
+		_root = std::move(other._root);
+		_size = std::exchange(other._size, 0);
+		_seed = other._seed;
+	}
+	return *this;
+}
+
+MisspelledRanges::~MisspelledRanges() = default;
+
+void MisspelledRanges::assign(const MisspelledWords &words) {
+	clear();
+	for (const auto &word : words) {
+		insert(word);
+	}
+}
+
+void MisspelledRanges::clear() {
+	_root = nullptr;
+	_size = 0;
+}
+
+void MisspelledRanges::insert(MisspelledWord word) {
+	if (word.second <= 0) {
+		return;
+	}
+	remove(word.first, word.second);
+	auto [left, right] = split(std::move(_root), [&](const Node &node) {
+		return node.start < word.first;
+	});
+	_root = merge(
+		merge(std::move(left), create(word)),
+		std::move(right));
+	++_size;
+}
+
+void MisspelledRanges::remove(int position, int length) {
+	if (length <= 0 || !_root) {
+		return;
+	}
+	const auto till = position + length;
+	auto [left, right] = split(std::move(_root), [&](const Node &node) {
+		return node.start < till;
+	});
+	// The ranges don't overlap, so their ends are sorted as well.
+	auto [before, intersected] = split(std::move(left), [&](
+			const Node &node) {
+		return node.start + node.length <= position;
+	});
+	drop(std::move(intersected));
+	_root = merge(std::move(before), std::move(right));
+}
+
+void MisspelledRanges::truncate(int length) {
+	if (!_root) {
+		return;
+	}
+	auto [negative, rest] = split(std::move(_root), [](const Node &node) {
+		return node.start < 0;
+	});
+	drop(std::move(negative));
+	auto [inside, outside] = split(std::move(rest), [&](const Node &node) {
+		return node.start + node.length <= length;
+	});
+	drop(std::move(outside));
+	_root = std::move(inside);
+}
+
+void MisspelledRanges::shift(int position, int delta) {
+	if (!delta || !_root) {
+		return;
+	}
+	auto [left, right] = split(std::move(_root), [&](const Node &node) {
+		return node.start < position;
+	});
+	move(right.get(), delta);
+	_root = merge(std::move(left), std::move(right));
+}
+
+bool MisspelledRanges::empty() const {
+	return !_root;
+}
+
+int MisspelledRanges::size() const {
+	return _size;
+}
+
+MisspelledWords MisspelledRanges::values() const {
+	auto result = MisspelledWords();
+	result.reserve(_size);
+	enumerate(
+		std::numeric_limits<int>::min() / 2,
+		std::numeric_limits<int>::max(),
+		[&](MisspelledWord word) { result.push_back(word); });
+	return result;
+}
+
+void MisspelledRanges::push(Node *node) {
+	if (node->delta) {
+		move(node->left.get(), node->delta);
+		move(node->right.get(), node->delta);
+		node->delta = 0;
+	}
+}
+
+void MisspelledRanges::move(Node *node, int delta) {
+	if (node) {
+		node->start += delta;
+		node->delta += delta;
+	}
+}
+
+int MisspelledRanges::count(const Node *node) {
+	return node
+		? (1 + count(node->left.get()) + count(node->right.get()))
+		: 0;
+}
+
+template <typename Predicate>
+auto MisspelledRanges::split(Tree tree, Predicate &&predicate)
+-> std::pair<Tree, Tree> {
+	if (!tree) {
+		return {};
+	}
+	push(tree.get());
+	if (predicate(*tree)) {
+		auto [left, right] = split(std::move(tree->right), predicate);
+		tree->right = std::move(left);
+		return { std::move(tree), std::move(right) };
+	}
+	auto [left, right] = split(std::move(tree->left), predicate);
+	tree->left = std::move(right);
+	return { std::move(left), std::move(tree) };
+}
+
+auto MisspelledRanges::merge(Tree left, Tree right) -> Tree {
+	if (!left) {
+		return right;
+	} else if (!right) {
+		return left;
+	} else if (left->priority > right->priority) {
+		push(left.get());
+		left->right = merge(std::move(left->right), std::move(right));
+		return left;
+	}
+	push(right.get());
+	right->left = merge(std::move(left), std::move(right->left));
+	return right;
+}
+
+auto MisspelledRanges::create(MisspelledWord word) -> Tree {
+	auto result = std::make_unique<Node>();
+	result->start = word.first;
+	result->length = word.second;
+	result->priority = NextPriority(_seed);
+	return result;
+}
+
+void MisspelledRanges::drop(Tree tree) {
+	_size -= count(tree.get());
+}
+
+} // namespace Spellchecker
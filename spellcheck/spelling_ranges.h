@@ -0,0 +1,112 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include "spellcheck/spellcheck_types.h"
+
+#include <memory>
+
+namespace Spellchecker {
+
+// Sorted non-overlapping ranges of misspelled words.
+// It is a treap with a lazy shift of subtrees, so the shift of all
+// ranges after a position, the removal of ranges that intersect
+// some range and the lookup take a logarithmic time.
+class MisspelledRanges final {
+public:
+	MisspelledRanges();
+	MisspelledRanges(MisspelledRanges &&other) noexcept;
+	MisspelledRanges &operator=(MisspelledRanges &&other) noexcept;
+	~MisspelledRanges();
+
+	void assign(const MisspelledWords &words);
+	void clear();
+
+	// Replaces all ranges that intersect the word.
+	void insert(MisspelledWord word);
+
+	// Removes all ranges that intersect [position, position + length).
+	void remove(int position, int length);
+
+	// Removes all ranges that don't fit into [0, length).
+	void truncate(int length);
+
+	// Moves all ranges that start at or after the position.
+	// When moving to the left the overlapped ranges should be removed.
+	void shift(int position, int delta);
+
+	[[nodiscard]] bool empty() const;
+	[[nodiscard]] int size() const;
+	[[nodiscard]] MisspelledWords values() const;
+
+	// Calls the callback in order for the ranges
+	// that intersect [position, position + length).
+	template <typename Callback>
+	void enumerate(int position, int length, Callback &&callback) const {
+		if (length > 0) {
+			enumerate(_root.get(), 0, position, position + length, callback);
+		}
+	}
+
+private:
+	struct Node {
+		int start = 0;
+		int length = 0;
+
+		// Not yet applied to the children.
+		int delta = 0;
+
+		uint32 priority = 0;
+		std::unique_ptr<Node> left;
+		std::unique_ptr<Node> right;
+	};
+	using Tree = std::unique_ptr<Node>;
+
+	template <typename Callback>
+	static void enumerate(
+			const Node *node,
+			int delta,
+			int from,
+			int till,
+			Callback &callback) {
+		if (!node) {
+			return;
+		}
+		const auto start = node->start + delta;
+		const auto end = start + node->length;
+		const auto children = delta + node->delta;
+		if (start > from) {
+			enumerate(node->left.get(), children, from, till, callback);
+		}
+		if (start < till && end > from) {
+			callback(MisspelledWord(start, node->length));
+		}
+		if (end < till) {
+			enumerate(node->right.get(), children, from, till, callback);
+		}
+	}
+
+	static void push(Node *node);
+	static void move(Node *node, int delta);
+	static int count(const Node *node);
+
+	// The left part has the nodes that match the predicate,
+	// the predicate should be monotonic for the sorted ranges.
+	template <typename Predicate>
+	static std::pair<Tree, Tree> split(Tree tree, Predicate &&predicate);
+	static Tree merge(Tree left, Tree right);
+
+	Tree create(MisspelledWord word);
+	void drop(Tree tree);
+
+	Tree _root;
+	int _size = 0;
+	uint32 _seed = 0;
+
+};
+
+} // namespace Spellchecker
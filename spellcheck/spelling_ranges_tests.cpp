@@ -0,0 +1,221 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include <catch2/catch.hpp>
+
+#include "spellcheck/spelling_ranges.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace Spellchecker;
+
+namespace {
+
+[[nodiscard]] bool Intersects(MisspelledWord word, int from, int till) {
+	return (word.first < till) && (word.first + word.second > from);
+}
+
+// The same operations on a sorted vector.
+class ReferenceRanges final {
+public:
+	void insert(MisspelledWord word) {
+		if (word.second <= 0) {
+			return;
+		}
+		remove(word.first, word.second);
+		_words.insert(
+			std::lower_bound(begin(_words), end(_words), word),
+			word);
+	}
+	void remove(int position, int length) {
+		if (length <= 0) {
+			return;
+		}
+		const auto till = position + length;
+		_words.erase(std::remove_if(begin(_words), end(_words), [&](
+				MisspelledWord word) {
+			return Intersects(word, position, till);
+		}), end(_words));
+	}
+	void truncate(int length) {
+		_words.erase(std::remove_if(begin(_words), end(_words), [&](
+				MisspelledWord word) {
+			return (word.first < 0) || (word.first + word.second > length);
+		}), end(_words));
+	}
+	void shift(int position, int delta) {
+		for (auto &word : _words) {
+			if (word.first >= position) {
+				word.first += delta;
+			}
+		}
+	}
+	[[nodiscard]] MisspelledWords enumerate(int position, int length) const {
+		auto result = MisspelledWords();
+		if (length <= 0) {
+			return result;
+		}
+		for (const auto &word : _words) {
+			if (Intersects(word, position, position + length)) {
+				result.push_back(word);
+			}
+		}
+		return result;
+	}
+	[[nodiscard]] const MisspelledWords &values() const {
+		return _words;
+	}
+
+private:
+	MisspelledWords _words;
+
+};
+
+[[nodiscard]] MisspelledWords Enumerate(
+		const MisspelledRanges &ranges,
+		int position,
+		int length) {
+	auto result = MisspelledWords();
+	ranges.enumerate(position, length, [&](MisspelledWord word) {
+		result.push_back(word);
+	});
+	return result;
+}
+
+} // namespace
+
+TEST_CASE("misspelled ranges", "[spelling_ranges]") {
+	auto ranges = MisspelledRanges();
+	REQUIRE(ranges.empty());
+	ranges.assign({ { 20, 5 }, { 0, 3 }, { 10, 4 } });
+	REQUIRE(ranges.size() == 3);
+	REQUIRE(ranges.values() == MisspelledWords{
+		{ 0, 3 }, { 10, 4 }, { 20, 5 } });
+
+	SECTION("insert replaces the intersected ranges") {
+		ranges.insert({ 2, 9 });
+		REQUIRE(ranges.values() == MisspelledWords{ { 2, 9 }, { 20, 5 } });
+		REQUIRE(ranges.size() == 2);
+
+		ranges.insert({ 14, 6 });
+		REQUIRE(ranges.values() == MisspelledWords{
+			{ 2, 9 }, { 14, 6 }, { 20, 5 } });
+
+		ranges.insert({ 30, 0 });
+		REQUIRE(ranges.size() == 3);
+	}
+
+	SECTION("remove drops only the intersected ranges") {
+		ranges.remove(3, 7);
+		REQUIRE(ranges.size() == 3);
+
+		ranges.remove(13, 8);
+		REQUIRE(ranges.values() == MisspelledWords{ { 0, 3 } });
+		REQUIRE(ranges.size() == 1);
+
+		ranges.remove(0, 0);
+		REQUIRE(ranges.size() == 1);
+		ranges.remove(-5, 6);
+		REQUIRE(ranges.empty());
+		REQUIRE(ranges.size() == 0);
+	}
+
+	SECTION("shift moves the ranges starting at or after the position") {
+		ranges.shift(10, 5);
+		REQUIRE(ranges.values() == MisspelledWords{
+			{ 0, 3 }, { 15, 4 }, { 25, 5 } });
+
+		ranges.shift(16, -6);
+		REQUIRE(ranges.values() == MisspelledWords{
+			{ 0, 3 }, { 15, 4 }, { 19, 5 } });
+	}
+
+	SECTION("truncate drops the ranges outside of the text") {
+		ranges.shift(0, -1);
+		ranges.truncate(24);
+		REQUIRE(ranges.values() == MisspelledWords{ { 9, 4 }, { 19, 5 } });
+
+		ranges.truncate(23);
+		REQUIRE(ranges.values() == MisspelledWords{ { 9, 4 } });
+		REQUIRE(ranges.size() == 1);
+	}
+
+	SECTION("enumerate finds the intersected ranges in order") {
+		REQUIRE(Enumerate(ranges, 3, 7).empty());
+		REQUIRE(Enumerate(ranges, 2, 9) == MisspelledWords{
+			{ 0, 3 }, { 10, 4 } });
+		REQUIRE(Enumerate(ranges, 13, 100) == MisspelledWords{
+			{ 10, 4 }, { 20, 5 } });
+		REQUIRE(Enumerate(ranges, 21, 0).empty());
+	}
+
+	SECTION("moved ranges keep the values") {
+		auto moved = std::move(ranges);
+		REQUIRE(moved.size() == 3);
+		REQUIRE(ranges.empty());
+
+		ranges = std::move(moved);
+		REQUIRE(ranges.size() == 3);
+		REQUIRE(ranges.values() == MisspelledWords{
+			{ 0, 3 }, { 10, 4 }, { 20, 5 } });
+	}
+
+	SECTION("clear drops everything") {
+		ranges.clear();
+		REQUIRE(ranges.empty());
+		REQUIRE(ranges.values().empty());
+	}
+}
+
+TEST_CASE("misspelled ranges match the sorted vector", "[spelling_ranges]") {
+	constexpr auto kOperations = 20000;
+	constexpr auto kTextSize = 1000;
+
+	auto generator = std::mt19937(42);
+	const auto random = [&](int from, int till) {
+		return std::uniform_int_distribution<int>(from, till)(generator);
+	};
+
+	auto ranges = MisspelledRanges();
+	auto reference = ReferenceRanges();
+	for (auto i = 0; i != kOperations; ++i) {
+		const auto position = random(-10, kTextSize);
+		const auto length = random(0, 20);
+		switch (random(0, 5)) {
+		case 0:
+		case 1:
+			ranges.insert({ position, length });
+			reference.insert({ position, length });
+			break;
+		case 2:
+			ranges.remove(position, length);
+			reference.remove(position, length);
+			break;
+		case 3:
+			// Same as a text change, the replaced ranges are removed.
+			ranges.remove(position - length, length);
+			reference.remove(position - length, length);
+			ranges.shift(position, -length);
+			reference.shift(position, -length);
+			break;
+		case 4:
+			ranges.shift(position, length);
+			reference.shift(position, length);
+			break;
+		case 5:
+			if (random(0, 20) == 0) {
+				ranges.truncate(kTextSize);
+				reference.truncate(kTextSize);
+			}
+			REQUIRE(Enumerate(ranges, position, length)
+				== reference.enumerate(position, length));
+			break;
+		}
+		REQUIRE(ranges.size() == int(reference.values().size()));
+	}
+	REQUIRE(ranges.values() == reference.values());
+}
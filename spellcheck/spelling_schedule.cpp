@@ -0,0 +1,37 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "spellcheck/spelling_schedule.h"
+
+namespace Spellchecker {
+
+BlocksSchedule ScheduleDirtyBlocks(
+		const std::vector<DirtyBlock> &dirty,
+		int firstVisible,
+		int lastVisible,
+		int partLength) {
+	auto visible = std::vector<int>();
+	auto hidden = std::vector<int>();
+	auto hiddenLength = 0;
+	auto more = false;
+	for (auto i = 0, count = int(dirty.size()); i != count; ++i) {
+		const auto &block = dirty[i];
+		if (block.number >= firstVisible && block.number <= lastVisible) {
+			visible.push_back(i);
+		} else if (hiddenLength < partLength) {
+			hidden.push_back(i);
+			hiddenLength += block.length;
+		} else {
+			more = true;
+		}
+	}
+	if (visible.empty()) {
+		return { std::move(hidden), more };
+	}
+	return { std::move(visible), more || !hidden.empty() };
+}
+
+} // namespace Spellchecker
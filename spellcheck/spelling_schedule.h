@@ -0,0 +1,35 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include <vector>
+
+namespace Spellchecker {
+
+struct DirtyBlock {
+	int number = 0;
+	int length = 0;
+};
+
+struct BlocksSchedule {
+	// Indices of the blocks to check now, in the document order.
+	std::vector<int> indices;
+
+	// Some dirty blocks are left for the next part.
+	bool more = false;
+};
+
+// The visible blocks are checked first, the rest of the document
+// follows by parts, so the first underlines don't wait for it.
+// A part is finished as soon as its length reaches the part length.
+[[nodiscard]] BlocksSchedule ScheduleDirtyBlocks(
+	const std::vector<DirtyBlock> &dirty,
+	int firstVisible,
+	int lastVisible,
+	int partLength);
+
+} // namespace Spellchecker
@@ -0,0 +1,58 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include <catch2/catch.hpp>
+
+#include "spellcheck/spelling_schedule.h"
+
+using namespace Spellchecker;
+
+TEST_CASE("dirty blocks schedule", "[spelling_schedule]") {
+	using Indices = std::vector<int>;
+
+	SECTION("nothing is scheduled without dirty blocks") {
+		const auto schedule = ScheduleDirtyBlocks({}, 0, 10, 100);
+		REQUIRE(schedule.indices.empty());
+		REQUIRE(!schedule.more);
+	}
+
+	SECTION("visible blocks are checked first") {
+		const auto dirty = std::vector<DirtyBlock>{
+			{ 0, 10 }, { 3, 10 }, { 4, 10 }, { 8, 10 },
+		};
+		const auto schedule = ScheduleDirtyBlocks(dirty, 3, 5, 100);
+		REQUIRE(schedule.indices == Indices{ 1, 2 });
+		REQUIRE(schedule.more);
+	}
+
+	SECTION("only visible blocks are dirty") {
+		const auto dirty = std::vector<DirtyBlock>{ { 3, 1000 }, { 5, 1 } };
+		const auto schedule = ScheduleDirtyBlocks(dirty, 3, 5, 100);
+		REQUIRE(schedule.indices == Indices{ 0, 1 });
+		REQUIRE(!schedule.more);
+	}
+
+	SECTION("hidden blocks are checked by parts") {
+		const auto dirty = std::vector<DirtyBlock>{
+			{ 0, 40 }, { 1, 40 }, { 2, 40 }, { 7, 40 }, { 9, 40 },
+		};
+		const auto first = ScheduleDirtyBlocks(dirty, 4, 6, 100);
+		REQUIRE(first.indices == Indices{ 0, 1, 2 });
+		REQUIRE(first.more);
+
+		const auto rest = std::vector<DirtyBlock>{ { 7, 40 }, { 9, 40 } };
+		const auto second = ScheduleDirtyBlocks(rest, 4, 6, 100);
+		REQUIRE(second.indices == Indices{ 0, 1 });
+		REQUIRE(!second.more);
+	}
+
+	SECTION("a long hidden block makes a part by itself") {
+		const auto dirty = std::vector<DirtyBlock>{ { 0, 500 }, { 1, 1 } };
+		const auto schedule = ScheduleDirtyBlocks(dirty, 5, 6, 100);
+		REQUIRE(schedule.indices == Indices{ 0 });
+		REQUIRE(schedule.more);
+	}
+}
@@ -7,13 +7,21 @@
 
 #include "spellcheck/third_party/hunspell_controller.h"
 
+#include "spellcheck/spellcheck_cache.h"
+#include "spellcheck/spellcheck_journal.h"
+#include "spellcheck/spellcheck_stats.h"
 #include "spellcheck/spellcheck_value.h"
+#include "base/timer.h"
+#include "crl/crl_queue.h"
 
+#include <limits>
 #include <mutex>
 #include <shared_mutex>
+#include <unordered_set>
 
 #include <QDir>
 #include <QFileInfo>
+#include <QSaveFile>
 
 #include <hunspell/hunspell.hxx>
 
@@ -28,11 +36,31 @@ using namespace gi::repository;
 namespace Platform::Spellchecker::ThirdParty {
 namespace {
 
-using WordsMap = std::map<QChar::Script, std::vector<QString>>;
-
 // Maximum number of words in the custom spellcheck dictionary.
 constexpr auto kMaxSyncableDictionaryWords = 1300;
+constexpr auto kMaxCustomDictionarySize = 100 * 1024;
+
+// The custom dictionary is written once in a while,
+// all its changes in between are appended to the journal.
+// A larger journal is compacted right after it is applied.
+constexpr auto kMaxJournalRecords = 256;
+constexpr auto kMaxJournalSize = 1024 * 1024;
 constexpr auto kTimeLimitSuggestion = crl::time(1000);
+constexpr auto kMaxCachedVerdicts = 8192;
+constexpr auto kMaxCachedSuggestions = 256;
+
+// Only a few misspelled words of each check are prefetched,
+// the rest of them are unlikely to be asked for.
+constexpr auto kMaxPrefetchedWords = 4;
+
+// Parsing of a dictionary is slow, so the engines of the languages
+// that were disabled recently are kept for a quick re-enabling.
+constexpr auto kMaxReleasedEngines = 2;
+
+// The engines that were not used for a while are unloaded,
+// they will be loaded again when a word of their script is checked.
+constexpr auto kDefaultIdleUnloadTimeout = 30 * 60 * crl::time(1000);
+constexpr auto kIdleUnloadCheckInterval = 60 * crl::time(1000);
 
 #ifdef Q_OS_WIN
 const auto kLineBreak = QByteArrayLiteral("\r\n");
@@ -40,6 +68,20 @@ const auto kLineBreak = QByteArrayLiteral("\r\n");
 const auto kLineBreak = QByteArrayLiteral("\n");
 #endif // Q_OS_WIN
 
+// Returns an empty string if there is no dictionary for the language.
+[[nodiscard]] QString DictionaryPath(const QString &lang) {
+	const auto workingDir = ::Spellchecker::WorkingDirPath();
+	if (workingDir.isEmpty()) {
+		return QString();
+	}
+	const auto rawPath = QString("%1/%2/%2").arg(workingDir, lang);
+	if (!QFileInfo(rawPath + ".aff").isFile()
+		|| !QFileInfo(rawPath + ".dic").isFile()) {
+		return QString();
+	}
+	return rawPath;
+}
+
 struct PathPair {
 	QByteArray aff;
 	QByteArray dic;
@@ -71,6 +113,24 @@ QString CustomDictionaryPath() {
 		"custom");
 }
 
+QString CustomDictionaryJournalPath() {
+	return CustomDictionaryPath() + u".journal"_q;
+}
+
+[[nodiscard]] QByteArray ReadSmallFile(const QString &path, int64 limit) {
+	auto f = QFile(path);
+	if (const auto info = QFileInfo(f);
+		!info.isFile()
+		|| (info.size() > limit)
+		|| !f.open(QIODevice::ReadOnly)) {
+		if (info.isDir()) {
+			QDir(info.path()).removeRecursively();
+		}
+		return QByteArray();
+	}
+	return f.readAll();
+}
+
 [[nodiscard]] Hunspell LoadUtfInitializer() {
 	const auto full = [&](const QString &name) {
 		return ::Spellchecker::WorkingDirPath() + '/' + name;
@@ -97,10 +157,13 @@ QString CustomDictionaryPath() {
 class CharsetConverter final {
 public:
 	CharsetConverter(const std::string &charset)
+	: _utf8(QByteArray::fromStdString(charset).compare(
+		"UTF-8",
+		Qt::CaseInsensitive) == 0)
 #if __has_include(<glib/glib.hpp>)
-	: _charset(charset)
+	, _charset(charset)
 #elif QT_VERSION < QT_VERSION_CHECK(6, 0, 0) // __has_include(<glib/glib.hpp>)
-	: _codec(QTextCodec::codecForName(charset.c_str()))
+	, _codec(QTextCodec::codecForName(charset.c_str()))
 #endif // Qt < 6.0.0
 	{}
 
@@ -118,14 +181,7 @@ public:
 
 	[[nodiscard]] std::string fromUnicode(const QString &data) {
 #if __has_include(<glib/glib.hpp>)
-		const auto utf8 = data.toStdString();
-		return GLib::convert(
-			reinterpret_cast<const uchar*>(utf8.data()),
-			utf8.size(),
-			_charset,
-			"UTF-8",
-			nullptr,
-			nullptr) | ranges::to<std::string>;
+		return fromUtf8(data.toStdString());
 #elif QT_VERSION < QT_VERSION_CHECK(6, 0, 0) // __has_include(<glib/glib.hpp>)
 		return _codec->fromUnicode(data).toStdString();
 #else // Qt < 6.0.0
@@ -133,6 +189,48 @@ public:
 #endif // Qt >= 6.0.0 && !__has_include(<glib/glib.hpp>)
 	}
 
+	// Converts all the words at once, each word ends with '\n' in the arena.
+	void fromUnicode(
+			const std::vector<QStringView> &words,
+			std::string &arena) {
+		arena.clear();
+		if (_utf8) {
+			for (const auto &word : words) {
+				::Spellchecker::AppendUtf8(arena, word);
+				arena.push_back('\n');
+			}
+			return;
+		}
+#if __has_include(<glib/glib.hpp>)
+		auto utf8 = std::string();
+		for (const auto &word : words) {
+			::Spellchecker::AppendUtf8(utf8, word);
+			utf8.push_back('\n');
+		}
+		arena = fromUtf8(utf8);
+		if (!arena.empty() || words.empty()) {
+			return;
+		}
+
+		// A single word that the charset can't encode fails the batch.
+		// Such words are left empty in the arena, the rest is converted.
+		for (const auto &word : words) {
+			utf8.clear();
+			::Spellchecker::AppendUtf8(utf8, word);
+			arena.append(fromUtf8(utf8));
+			arena.push_back('\n');
+		}
+#elif QT_VERSION < QT_VERSION_CHECK(6, 0, 0) // __has_include(<glib/glib.hpp>)
+		auto joined = QString();
+		for (const auto &word : words) {
+			joined.append(word.data(), word.size());
+			joined.append(QChar('\n'));
+		}
+		const auto converted = _codec->fromUnicode(joined);
+		arena.assign(converted.constData(), converted.size());
+#endif // Qt < 6.0.0
+	}
+
 	[[nodiscard]] QString toUnicode(const std::string &data) {
 #if __has_include(<glib/glib.hpp>)
 		return QString::fromStdString(GLib::convert(
@@ -150,6 +248,19 @@ public:
 	}
 
 private:
+#if __has_include(<glib/glib.hpp>)
+	[[nodiscard]] std::string fromUtf8(const std::string &utf8) const {
+		return GLib::convert(
+			reinterpret_cast<const uchar*>(utf8.data()),
+			utf8.size(),
+			_charset,
+			"UTF-8",
+			nullptr,
+			nullptr) | ranges::to<std::string>;
+	}
+#endif // __has_include(<glib/glib.hpp>)
+
+	bool _utf8 = false;
 #if __has_include(<glib/glib.hpp>)
 	std::string _charset;
 #elif QT_VERSION < QT_VERSION_CHECK(6, 0, 0) // __has_include(<glib/glib.hpp>)
@@ -158,6 +269,45 @@ private:
 
 };
 
+struct HashedWord {
+	explicit HashedWord(const QString &word)
+	: word(word)
+	, hash(qHash(word)) {
+	}
+
+	QString word;
+	size_t hash = 0;
+
+	friend inline bool operator==(
+			const HashedWord &a,
+			const HashedWord &b) {
+		return (a.hash == b.hash) && (a.word == b.word);
+	}
+};
+
+struct HashedWordHash {
+	[[nodiscard]] size_t operator()(const HashedWord &value) const {
+		return value.hash;
+	}
+};
+
+// Words are looked up from any thread, but changed only from the main one.
+class WordsSet final {
+public:
+	[[nodiscard]] bool contains(const HashedWord &word) const;
+	[[nodiscard]] std::vector<QString> words() const;
+	[[nodiscard]] int size() const;
+
+	void add(const QString &word);
+	void remove(const QString &word);
+	void assign(std::vector<QString> words);
+
+private:
+	mutable std::shared_mutex _mutex;
+	std::unordered_set<HashedWord, HashedWordHash> _words;
+
+};
+
 class HunspellEngine {
 public:
 	HunspellEngine(const QString &lang);
@@ -165,14 +315,21 @@ public:
 
 	bool isValid() const;
 
-	bool spell(const QString &word) const;
+	// Returns a verdict for each word.
+	std::vector<bool> spell(const std::vector<QStringView> &words) const;
 
+	// Hunspell keeps some state while suggesting,
+	// so the concurrent requests to a single engine are serialized.
 	void suggest(
 		const QString &wrongWord,
 		std::vector<QString> *optionalSuggestions);
 
-	QString lang();
-	QChar::Script script();
+	QString lang() const;
+	QChar::Script script() const;
+	crl::time lastUsed() const;
+
+	// The sizes of the dictionary files, not of the loaded engine.
+	int64 dictionarySize() const;
 
 	HunspellEngine(const HunspellEngine &) = delete;
 	HunspellEngine &operator=(const HunspellEngine &) = delete;
@@ -182,9 +339,16 @@ private:
 	QChar::Script _script;
 	std::unique_ptr<Hunspell> _hunspell;
 	std::unique_ptr<CharsetConverter> _converter;
+	mutable std::atomic<crl::time> _lastUsed = 0;
+	std::mutex _suggestMutex;
+	int64 _dictionarySize = 0;
 
 };
 
+// The engines are shared by the lists of the service and the running
+// requests, so a request may finish with an engine that was released.
+using EnginePtr = std::shared_ptr<HunspellEngine>;
+
 class HunspellService {
 public:
 	HunspellService();
@@ -192,11 +356,22 @@ public:
 
 	void updateLanguages(std::vector<QString> langs);
 	std::vector<QString> activeLanguages();
+	std::vector<QString> pendingLanguages();
 	[[nodiscard]] bool checkSpelling(const QString &wordToCheck);
+	[[nodiscard]] std::vector<bool> checkSpellingWords(
+		const std::vector<QStringView> &words);
+	void setParallelChecking(bool enabled);
+	void setIdleUnloadTimeout(crl::time timeout);
+	[[nodiscard]] EnginesUsage usage();
 
 	void fillSuggestionList(
 		const QString &wrongWord,
 		std::vector<QString> *optionalSuggestions);
+	void fillSuggestionListByParts(
+		const QString &wrongWord,
+		Fn<bool(std::vector<QString> &&part)> callback);
+	void prefetchSuggestions(std::vector<QString> words);
+	void setSuggestionsPrefetch(bool enabled);
 
 	void addWord(const QString &word);
 	void removeWord(const QString &word);
@@ -204,41 +379,118 @@ public:
 	bool isWordInDictionary(const QString &word);
 
 private:
-	void writeToFile();
-	void readFile();
+	struct PendingLanguage {
+		QString lang;
+		QChar::Script script = QChar::Script_Unknown;
+		bool loading = false;
+	};
 
-	std::vector<QString> &addedWords(const QString &word);
+	void appendToJournal(char operation, const QString &word);
+	void compactJournal();
+	void readFile();
 
-	std::shared_ptr<std::vector<std::unique_ptr<HunspellEngine>>> _engines;
+	void loadPending(const std::vector<QChar::Script> &scripts);
+	void unloadIdle();
+	// The verdicts of the words of the scripts are changed,
+	// by default it is found by the languages.
+	void enginesChanged(
+		bool languagesChanged,
+		std::vector<QChar::Script> scripts = {});
+
+	// Should be called under the unique lock.
+	void release(EnginePtr engine);
+	void insert(EnginePtr engine);
+
+	std::shared_ptr<std::vector<EnginePtr>> _engines;
+	// Guarded by _engineMutex as well, the most recent engine goes first.
+	std::shared_ptr<std::vector<EnginePtr>> _released;
+	// Guarded by _engineMutex as well.
+	// The enabled languages, the engines are kept in their order.
+	std::vector<QString> _languages;
+	// The enabled languages that are loaded on demand.
+	std::vector<PendingLanguage> _pending;
+	// Main thread only, the languages with loaded engines
+	// and the languages that wait for their engines.
 	std::vector<QString> _activeLanguages;
+	std::vector<QString> _pendingLanguages;
 	// Use an empty Hunspell dictionary to fill it with our remembered words
 	// for getting suggests.
 	std::unique_ptr<Hunspell> _customDict;
-	WordsMap _ignoredWords;
-	WordsMap _addedWords;
+	std::mutex _customDictMutex;
+	WordsSet _ignoredWords;
+	WordsSet _addedWords;
+
+	::Spellchecker::VerdictCache _verdicts;
+	::Spellchecker::SuggestionsCache _suggestions;
+
+	// The prefetch takes a single worker of the pool at most,
+	// so it doesn't slow down the actual checks.
+	crl::queue _prefetchQueue;
+	std::atomic<bool> _prefetch = false;
+
+	// All the writes of the custom dictionary are ordered by the queue.
+	crl::queue _fileQueue;
+	int _journalRecords = 0;
 
 	std::shared_ptr<std::atomic<int>> _epoch;
-	std::atomic<int> _suggestionsEpoch = 0;
+	std::atomic<bool> _parallelChecking = false;
+	std::atomic<crl::time> _idleUnloadTimeout = kDefaultIdleUnloadTimeout;
+	std::unique_ptr<base::Timer> _unloadTimer;
 
 	std::shared_ptr<std::shared_mutex> _engineMutex;
 
 };
 
-HunspellEngine::HunspellEngine(const QString &lang)
-: _lang(lang)
-, _script(::Spellchecker::LocaleToScriptCode(lang)) {
-	const auto workingDir = ::Spellchecker::WorkingDirPath();
-	if (workingDir.isEmpty()) {
-		return;
+bool WordsSet::contains(const HashedWord &word) const {
+	std::shared_lock lock(_mutex);
+	return _words.contains(word);
+}
+
+std::vector<QString> WordsSet::words() const {
+	std::shared_lock lock(_mutex);
+	return ranges::views::all(
+		_words
+	) | ranges::views::transform(&HashedWord::word) | ranges::to_vector;
+}
+
+int WordsSet::size() const {
+	std::shared_lock lock(_mutex);
+	return int(_words.size());
+}
+
+void WordsSet::add(const QString &word) {
+	std::unique_lock lock(_mutex);
+	_words.emplace(word);
+}
+
+void WordsSet::remove(const QString &word) {
+	std::unique_lock lock(_mutex);
+	_words.erase(HashedWord(word));
+}
+
+void WordsSet::assign(std::vector<QString> words) {
+	auto result = std::unordered_set<HashedWord, HashedWordHash>();
+	result.reserve(words.size());
+	for (const auto &word : words) {
+		result.emplace(word);
 	}
-	const auto rawPath = QString("%1/%2/%2").arg(workingDir, lang);
-	const auto affPath = rawPath + ".aff";
-	const auto dicPath = rawPath + ".dic";
+	std::unique_lock lock(_mutex);
+	_words = std::move(result);
+}
 
-	if (!QFileInfo(affPath).isFile() || !QFileInfo(dicPath).isFile()) {
+HunspellEngine::HunspellEngine(const QString &lang)
+: _lang(lang)
+, _script(::Spellchecker::LocaleToScriptCode(lang))
+, _lastUsed(crl::now()) {
+	const auto timer = ::Spellchecker::StatsTimer(
+		::Spellchecker::Timing::EngineLoad);
+	const auto rawPath = DictionaryPath(lang);
+	if (rawPath.isEmpty()) {
 		return;
 	}
-	const auto prepared = PreparePaths(affPath, dicPath);
+	_dictionarySize = QFileInfo(rawPath + ".aff").size()
+		+ QFileInfo(rawPath + ".dic").size();
+	const auto prepared = PreparePaths(rawPath + ".aff", rawPath + ".dic");
 	_hunspell = std::make_unique<Hunspell>(
 		prepared.aff.constData(),
 		prepared.dic.constData());
@@ -254,16 +506,47 @@ bool HunspellEngine::isValid() const {
 	return _hunspell != nullptr;
 }
 
-bool HunspellEngine::spell(const QString &word) const {
-	return _hunspell->spell(_converter->fromUnicode(word));
+std::vector<bool> HunspellEngine::spell(
+		const std::vector<QStringView> &words) const {
+	// Both buffers are reused by all the engines working in the thread.
+	thread_local auto arena = std::string();
+	thread_local auto word = std::string();
+
+	_lastUsed = crl::now();
+	const auto timer = ::Spellchecker::StatsTimer(
+		::Spellchecker::Timing::HunspellSpell);
+
+	auto result = std::vector<bool>(words.size(), false);
+	_converter->fromUnicode(words, arena);
+
+	auto from = std::string::size_type(0);
+	for (auto i = 0; i != words.size(); ++i) {
+		const auto till = arena.find('\n', from);
+		if (till == std::string::npos) {
+			break;
+		}
+		word.assign(arena, from, till - from);
+
+		// The words that the dictionary charset can't encode are empty.
+		result[i] = !word.empty() && _hunspell->spell(word);
+		from = till + 1;
+	}
+	return result;
 }
 
 void HunspellEngine::suggest(
 	const QString &wrongWord,
 	std::vector<QString> *optionalSuggestions) {
+	_lastUsed = crl::now();
 	const auto stdWord = _converter->fromUnicode(wrongWord);
-
-	for (const auto &guess : _hunspell->suggest(stdWord)) {
+	const auto guesses = [&] {
+		std::lock_guard lock(_suggestMutex);
+		const auto timer = ::Spellchecker::StatsTimer(
+			::Spellchecker::Timing::HunspellSuggest);
+		return _hunspell->suggest(stdWord);
+	}();
+
+	for (const auto &guess : guesses) {
 		if (optionalSuggestions->size()	== kMaxSuggestions) {
 			return;
 		}
@@ -275,22 +558,37 @@ void HunspellEngine::suggest(
 	}
 }
 
-QString HunspellEngine::lang() {
+QString HunspellEngine::lang() const {
 	return _lang;
 }
 
-QChar::Script HunspellEngine::script() {
+QChar::Script HunspellEngine::script() const {
 	return _script;
 }
 
+crl::time HunspellEngine::lastUsed() const {
+	return _lastUsed.load();
+}
+
+int64 HunspellEngine::dictionarySize() const {
+	return _dictionarySize;
+}
+
 std::vector<QString> HunspellService::activeLanguages() {
 	return _activeLanguages;
 }
 
+std::vector<QString> HunspellService::pendingLanguages() {
+	return _pendingLanguages;
+}
+
 // Thread: Any.
 HunspellService::HunspellService()
-: _engines(std::make_shared<std::vector<std::unique_ptr<HunspellEngine>>>())
+: _engines(std::make_shared<std::vector<EnginePtr>>())
+, _released(std::make_shared<std::vector<EnginePtr>>())
 , _customDict(std::make_unique<Hunspell>("", ""))
+, _verdicts(kMaxCachedVerdicts)
+, _suggestions(kMaxCachedSuggestions)
 , _epoch(std::make_shared<std::atomic<int>>(0))
 , _engineMutex(std::make_shared<std::shared_mutex>()) {
 
@@ -305,272 +603,640 @@ HunspellService::~HunspellService() {
 	std::unique_lock lock(*_engineMutex);
 }
 
-// Thread: Main.
-std::vector<QString> &HunspellService::addedWords(const QString &word) {
-	return _addedWords[::Spellchecker::WordScript(word)];
-}
-
 // Thread: Main.
 void HunspellService::updateLanguages(std::vector<QString> langs) {
-	Expects(_suggestionsEpoch.load() == 0);
+	// The suggestion requests keep their own references to the engines,
+	// so the engines are replaced without waiting for them.
 	*_epoch += 1;
+	_verdicts.invalidate();
+	_suggestions.invalidate();
 
 	_activeLanguages.clear();
+	_pendingLanguages.clear();
+
+	if (!_unloadTimer) {
+		_unloadTimer = std::make_unique<base::Timer>([=] {
+			crl::async([=] { unloadIdle(); });
+		});
+		_unloadTimer->callEach(kIdleUnloadCheckInterval);
+	}
 
 	const auto savedEpoch = _epoch.get()->load();
 	crl::async([=,
 		epoch = _epoch,
 		engineMutex = _engineMutex,
-		engines = _engines] {
-		using UniqueEngine = std::unique_ptr<HunspellEngine>;
-
-		const auto engineLangFilter = [&](const UniqueEngine &engine) {
-			return engine ? ranges::contains(langs, engine->lang()) : false;
-		};
-
+		engines = _engines,
+		released = _released] {
 		if (savedEpoch != epoch.get()->load()) {
 			return;
 		}
 
-		const auto engineLang = [](const UniqueEngine &engine) {
+		const auto engineLang = [](const EnginePtr &engine) {
 			return engine ? engine->lang() : QString();
 		};
 
-		const auto missedLangs = [&] {
-			std::shared_lock lock(*engineMutex);
+		const auto available = ranges::views::all(
+			langs
+		) | ranges::views::filter([](const QString &lang) {
+			return !DictionaryPath(lang).isEmpty();
+		}) | ranges::to_vector;
 
-			return ranges::views::all(
-				langs
-			) | ranges::views::filter([&](auto &lang) {
-				return !ranges::contains(*engines, lang, engineLang);
-			}) | ranges::to_vector;
-		}();
-
-		// Added new enabled engines.
-		auto localEngines = ranges::views::all(
-			missedLangs
-		) | ranges::views::transform([&](auto &lang) -> UniqueEngine {
+		{
+			std::unique_lock lock(*engineMutex);
 			if (savedEpoch != epoch.get()->load()) {
-				return nullptr;
+				return;
 			}
-			auto engine = std::make_unique<HunspellEngine>(lang);
-			if (!engine->isValid()) {
-				return nullptr;
+
+			auto enabled = std::vector<EnginePtr>();
+			for (auto &engine : *engines) {
+				if (ranges::contains(langs, engine->lang())) {
+					enabled.push_back(std::move(engine));
+				} else {
+					release(std::move(engine));
+				}
 			}
-			return engine;
-		}) | ranges::to_vector;
 
-		if (savedEpoch != epoch.get()->load()) {
-			return;
+			// The dictionaries of other languages are loaded on demand,
+			// when a word of their script is checked for the first time.
+			_pending.clear();
+			for (const auto &lang : available) {
+				if (ranges::contains(enabled, lang, engineLang)) {
+					continue;
+				}
+				// Enabled again before the released engine was destroyed.
+				const auto i = ranges::find(*released, lang, engineLang);
+				if (i != end(*released)) {
+					enabled.push_back(std::move(*i));
+					released->erase(i);
+				} else {
+					_pending.push_back({
+						.lang = lang,
+						.script = ::Spellchecker::LocaleToScriptCode(lang),
+					});
+				}
+			}
+			_languages = langs;
+			engines->clear();
+			for (auto &engine : enabled) {
+				insert(std::move(engine));
+			}
 		}
-
+		enginesChanged(true);
+
+		// The language of the highest priority is loaded right away,
+		// its words are likely to be checked first.
+		const auto first = available.empty()
+			? QString()
+			: available.front();
+		auto warm = std::vector<QChar::Script>();
 		{
-			std::unique_lock lock(*engineMutex);
+			std::shared_lock lock(*engineMutex);
+			if (ranges::contains(_pending, first, &PendingLanguage::lang)) {
+				warm.push_back(::Spellchecker::LocaleToScriptCode(first));
+			}
+		}
+		if (!warm.empty()) {
+			loadPending(warm);
+		}
+	});
+}
 
-			*engines = ranges::views::concat(
-				*engines, localEngines
-			) | ranges::views::filter(
-				// All filtered objects will be automatically released.
-				engineLangFilter
-			) | ranges::views::transform([](auto &engine) {
-				return std::move(engine);
-			}) | ranges::to_vector;
+// Thread: Any.
+void HunspellService::loadPending(const std::vector<QChar::Script> &scripts) {
+	auto langs = std::vector<QString>();
+	auto savedEpoch = 0;
+	{
+		std::unique_lock lock(*_engineMutex);
+		savedEpoch = _epoch->load();
+		for (auto &pending : _pending) {
+			if (!pending.loading && ranges::contains(scripts, pending.script)) {
+				pending.loading = true;
+				langs.push_back(pending.lang);
+			}
 		}
+	}
 
-		crl::on_main([=] {
-			if (savedEpoch != epoch.get()->load()) {
+	// Each dictionary is parsed in its own task,
+	// so the first language is ready while the others are loading.
+	for (const auto &lang : langs) {
+		crl::async([=] {
+			if (savedEpoch != _epoch->load()) {
 				return;
 			}
-			*epoch = 0;
-			_activeLanguages = ranges::views::all(
-				*engines
-			) | ranges::views::transform(&HunspellEngine::lang)
-			| ranges::to_vector;
-			::Spellchecker::UpdateSupportedScripts(_activeLanguages);
+			auto engine = std::make_shared<HunspellEngine>(lang);
+			{
+				std::unique_lock lock(*_engineMutex);
+				if (savedEpoch != _epoch->load()) {
+					if (engine->isValid()) {
+						// It may be enabled again by the newer update.
+						release(std::move(engine));
+					}
+					return;
+				}
+				_pending.erase(
+					ranges::remove(_pending, lang, &PendingLanguage::lang),
+					end(_pending));
+				if (engine->isValid()) {
+					insert(std::move(engine));
+				}
+			}
+			enginesChanged(true, { ::Spellchecker::LocaleToScriptCode(lang) });
 		});
+	}
+}
 
-	});
+// Thread: Any.
+void HunspellService::unloadIdle() {
+	const auto timeout = _idleUnloadTimeout.load();
+	if (timeout <= 0) {
+		return;
+	}
+	const auto now = crl::now();
+
+	// The dictionaries are destroyed outside of the lock.
+	auto unloaded = std::vector<EnginePtr>();
+	{
+		std::unique_lock lock(*_engineMutex);
+		for (auto i = begin(*_engines); i != end(*_engines);) {
+			const auto &engine = *i;
+			if (now - engine->lastUsed() < timeout) {
+				++i;
+				continue;
+			}
+			_pending.push_back({
+				.lang = engine->lang(),
+				.script = engine->script(),
+			});
+			unloaded.push_back(std::move(*i));
+			i = _engines->erase(i);
+		}
+	}
+	if (!unloaded.empty()) {
+		// The languages are still active, only the verdicts are changed.
+		enginesChanged(false);
+	}
 }
 
 // Thread: Any.
-bool HunspellService::checkSpelling(const QString &wordToCheck) {
-	const auto wordScript = ::Spellchecker::WordScript(wordToCheck);
-	if (ranges::contains(_ignoredWords[wordScript], wordToCheck)) {
-		return true;
+void HunspellService::enginesChanged(
+		bool languagesChanged,
+		std::vector<QChar::Script> scripts) {
+	_verdicts.invalidate();
+	_suggestions.invalidate();
+	if (!languagesChanged) {
+		return;
 	}
-	if (ranges::contains(_addedWords[wordScript], wordToCheck)) {
-		return true;
+	const auto savedEpoch = _epoch->load();
+	crl::on_main([=] {
+		if (savedEpoch != _epoch->load()) {
+			return;
+		}
+		auto supported = std::vector<QString>();
+		{
+			std::shared_lock lock(*_engineMutex);
+			_activeLanguages.clear();
+			_pendingLanguages.clear();
+			for (const auto &lang : _languages) {
+				if (ranges::contains(*_engines, lang, &HunspellEngine::lang)) {
+					_activeLanguages.push_back(lang);
+				} else if (ranges::contains(
+						_pending,
+						lang,
+						&PendingLanguage::lang)) {
+					_pendingLanguages.push_back(lang);
+				} else {
+					continue;
+				}
+				supported.push_back(lang);
+			}
+		}
+		// The scripts of the pending languages stay supported,
+		// so their words reach the service and load the dictionaries.
+		// The script of a loaded engine should be rechecked as well.
+		::Spellchecker::UpdateSupportedScripts(std::move(supported), scripts);
+	});
+}
+
+void HunspellService::release(EnginePtr engine) {
+	_released->insert(begin(*_released), std::move(engine));
+	if (int(_released->size()) > kMaxReleasedEngines) {
+		// All the least recent engines will be automatically released.
+		_released->resize(kMaxReleasedEngines);
 	}
+}
+
+void HunspellService::insert(EnginePtr engine) {
+	const auto lang = engine->lang();
+	if (ranges::contains(*_engines, lang, &HunspellEngine::lang)) {
+		// It was loaded twice because of a concurrent update.
+		return;
+	}
+	const auto index = [&](const QString &lang) {
+		return ranges::find(_languages, lang) - begin(_languages);
+	};
+	const auto i = ranges::find_if(*_engines, [&](const auto &other) {
+		return index(other->lang()) > index(lang);
+	});
+	_engines->insert(i, std::move(engine));
+}
+
+// Thread: Any.
+EnginesUsage HunspellService::usage() {
+	auto result = EnginesUsage();
 	std::shared_lock lock(*_engineMutex);
 	for (const auto &engine : *_engines) {
-		if (wordScript != engine->script()) {
+		++result.engines;
+		result.dictionaryFileBytes += engine->dictionarySize();
+	}
+	for (const auto &engine : *_released) {
+		++result.released;
+		result.dictionaryFileBytes += engine->dictionarySize();
+	}
+	return result;
+}
+
+// Thread: Any.
+void HunspellService::setIdleUnloadTimeout(crl::time timeout) {
+	_idleUnloadTimeout = timeout;
+}
+
+// Thread: Any.
+bool HunspellService::checkSpelling(const QString &wordToCheck) {
+	return checkSpellingWords({ QStringView(wordToCheck) }).front();
+}
+
+// Thread: Any.
+std::vector<bool> HunspellService::checkSpellingWords(
+		const std::vector<QStringView> &words) {
+	auto result = std::vector<bool>(words.size(), false);
+	const auto epoch = _verdicts.epoch();
+	::Spellchecker::Count(
+		::Spellchecker::Counter::HunspellWords,
+		int64(words.size()));
+
+	// Indices of words that should be checked by the engines.
+	auto left = std::vector<int>();
+	auto scripts = std::vector<QChar::Script>();
+	for (auto i = 0; i != words.size(); ++i) {
+		const auto &word = words[i];
+		if (const auto cached = _verdicts.find(word)) {
+			result[i] = *cached;
+			continue;
+		}
+		const auto hashed = HashedWord(
+			QString::fromRawData(word.data(), word.size()));
+		if (_ignoredWords.contains(hashed) || _addedWords.contains(hashed)) {
+			result[i] = true;
 			continue;
 		}
-		if (engine->spell(wordToCheck)) {
-			return true;
+		left.push_back(i);
+		scripts.push_back(::Spellchecker::WordScript(word));
+	}
+	if (left.empty()) {
+		return result;
+	}
+
+	// Skips the words that are already proven to be correct.
+	const auto spell = [&](
+			not_null<const HunspellEngine*> engine,
+			std::vector<bool> &verdicts) {
+		auto indices = std::vector<int>();
+		auto batch = std::vector<QStringView>();
+		for (auto j = 0; j != left.size(); ++j) {
+			if (!verdicts[j] && (scripts[j] == engine->script())) {
+				indices.push_back(j);
+				batch.push_back(words[left[j]]);
+			}
+		}
+		if (batch.empty()) {
+			return;
+		}
+		const auto passed = engine->spell(batch);
+		for (auto k = 0; k != indices.size(); ++k) {
+			if (passed[k]) {
+				verdicts[indices[k]] = true;
+			}
+		}
+	};
+
+	auto verdicts = std::vector<bool>(left.size(), false);
+	auto waiting = std::vector<QChar::Script>();
+	auto load = false;
+	{
+		std::shared_lock lock(*_engineMutex);
+		const auto engines = ranges::views::all(
+			*_engines
+		) | ranges::views::filter([&](const auto &engine) {
+			return ranges::contains(scripts, engine->script());
+		}) | ranges::views::transform([](const auto &engine) {
+			return not_null<const HunspellEngine*>(engine.get());
+		}) | ranges::to_vector;
+
+		// The words of the languages that are not loaded yet
+		// are considered correct until their dictionaries are loaded.
+		for (const auto &pending : _pending) {
+			if (!ranges::contains(scripts, pending.script)) {
+				continue;
+			}
+			load = load || !pending.loading;
+			const auto loaded = ranges::any_of(engines, [&](const auto &e) {
+				return e->script() == pending.script;
+			});
+			if (!loaded) {
+				waiting.push_back(pending.script);
+			}
+		}
+
+		if (_parallelChecking.load() && (engines.size() > 1)) {
+			// Each engine is used by a single worker with its own verdicts.
+			auto own = std::vector<std::vector<bool>>(
+				engines.size(),
+				verdicts);
+			::Spellchecker::InvokeInParallel(engines.size(), [&](int index) {
+				spell(engines[index], own[index]);
+			});
+			for (auto j = 0; j != left.size(); ++j) {
+				verdicts[j] = ranges::any_of(own, [&](const auto &v) {
+					return v[j];
+				});
+			}
+		} else {
+			for (const auto &engine : engines) {
+				spell(engine, verdicts);
+			}
 		}
 	}
+	if (load) {
+		loadPending(scripts);
+	}
+	for (auto j = 0; j != left.size(); ++j) {
+		if (ranges::contains(waiting, scripts[j])) {
+			result[left[j]] = true;
+			continue;
+		}
+		result[left[j]] = verdicts[j];
+		_verdicts.store(words[left[j]], verdicts[j], epoch);
+	}
+	return result;
+}
 
-	return false;
+// Thread: Any.
+void HunspellService::setParallelChecking(bool enabled) {
+	_parallelChecking = enabled;
 }
 
 // Thread: Any.
 void HunspellService::fillSuggestionList(
-	const QString &wrongWord,
-	std::vector<QString> *optionalSuggestions) {
+		const QString &wrongWord,
+		std::vector<QString> *optionalSuggestions) {
+	optionalSuggestions->clear();
+	fillSuggestionListByParts(wrongWord, [&](std::vector<QString> &&part) {
+		optionalSuggestions->insert(
+			end(*optionalSuggestions),
+			std::make_move_iterator(begin(part)),
+			std::make_move_iterator(end(part)));
+		return true;
+	});
+}
+
+// Thread: Any.
+void HunspellService::fillSuggestionListByParts(
+		const QString &wrongWord,
+		Fn<bool(std::vector<QString> &&part)> callback) {
+	const auto epoch = _suggestions.epoch();
+	if (auto cached = _suggestions.find(wrongWord)) {
+		if (!cached->empty()) {
+			callback(std::move(*cached));
+		}
+		return;
+	}
 	const auto wordScript = ::Spellchecker::WordScript(wrongWord);
 
-	const auto customGuesses = _customDict->suggest(wrongWord.toStdString());
-	*optionalSuggestions = ranges::views::all(
+	// The words of the custom dictionary are passed at once.
+	const auto customGuesses = [&] {
+		std::lock_guard lock(_customDictMutex);
+		return _customDict->suggest(wrongWord.toStdString());
+	}();
+	auto found = ranges::views::all(
 		customGuesses
 	) | ranges::views::take(
 		kMaxSuggestions
 	) | ranges::views::transform([](auto &guess) {
 		return QString::fromStdString(guess);
 	}) | ranges::to_vector;
+	if (!found.empty() && !callback(base::duplicate(found))) {
+		return;
+	}
 
 	const auto startTime = crl::now();
 
-	_suggestionsEpoch++;
-	const auto savedEpoch = _suggestionsEpoch.load();
-
-	{
-		std::shared_lock lock(*_engineMutex);
-		for (const auto &engine : *_engines) {
-			if (_suggestionsEpoch.load() > savedEpoch) {
-				// There is a newer request to fill suggestion list,
-				// So we should drop the current one.
-				optionalSuggestions->clear();
-				break;
-			}
-			if (optionalSuggestions->size()	== kMaxSuggestions
+	// Every request has its own state, so the concurrent requests
+	// don't affect each other and are cancelled only by their callbacks.
+	auto mutex = std::mutex();
+	auto cancelled = false;
+	auto complete = true;
+	const auto suggest = [&](not_null<HunspellEngine*> engine) {
+		{
+			std::lock_guard lock(mutex);
+			if (found.size() == kMaxSuggestions) {
+				return;
+			} else if (cancelled
 				|| ((crl::now() - startTime) > kTimeLimitSuggestion)) {
+				complete = false;
+				return;
+			}
+		}
+		auto guesses = std::vector<QString>();
+		engine->suggest(wrongWord, &guesses);
+
+		std::lock_guard lock(mutex);
+		if (cancelled) {
+			return;
+		}
+		auto part = std::vector<QString>();
+		for (auto &guess : guesses) {
+			if (found.size() == kMaxSuggestions) {
 				break;
+			} else if (!ranges::contains(found, guess)) {
+				found.push_back(guess);
+				part.push_back(std::move(guess));
 			}
-			if (wordScript != engine->script()) {
+		}
+		if (!part.empty() && !callback(std::move(part))) {
+			cancelled = true;
+			complete = false;
+		}
+	};
+
+	const auto engines = [&] {
+		std::shared_lock lock(*_engineMutex);
+		return ranges::views::all(
+			*_engines
+		) | ranges::views::filter([&](const auto &engine) {
+			return (engine->script() == wordScript);
+		}) | ranges::to_vector;
+	}();
+	::Spellchecker::InvokeInParallel(engines.size(), [&](int index) {
+		suggest(engines[index].get());
+	});
+	if (complete) {
+		_suggestions.store(wrongWord, std::move(found), epoch);
+	}
+}
+
+// Thread: Main.
+void HunspellService::prefetchSuggestions(std::vector<QString> words) {
+	if (!_prefetch.load()) {
+		return;
+	}
+	if (int(words.size()) > kMaxPrefetchedWords) {
+		words.resize(kMaxPrefetchedWords);
+	}
+	_prefetchQueue.async([=, words = std::move(words)] {
+		for (const auto &word : words) {
+			if (!_prefetch.load()) {
+				return;
+			} else if (_suggestions.contains(word)) {
 				continue;
 			}
-			engine->suggest(wrongWord, optionalSuggestions);
+			// The result is stored to the cache of suggestions.
+			fillSuggestionListByParts(word, [](std::vector<QString> &&) {
+				return true;
+			});
 		}
-	}
-	_suggestionsEpoch--;
+	});
+}
+
+// Thread: Any.
+void HunspellService::setSuggestionsPrefetch(bool enabled) {
+	_prefetch = enabled;
 }
 
 // Thread: Main.
 void HunspellService::ignoreWord(const QString &word) {
-	const auto wordScript = ::Spellchecker::WordScript(word);
-	_customDict->add(word.toStdString());
-	_ignoredWords[wordScript].push_back(word);
+	{
+		std::lock_guard lock(_customDictMutex);
+		_customDict->add(word.toStdString());
+	}
+	_ignoredWords.add(word);
+	_verdicts.invalidate();
+	_suggestions.invalidate();
 }
 
 // Thread: Main.
 bool HunspellService::isWordInDictionary(const QString &word) {
-	return ranges::contains(addedWords(word), word);
+	return _addedWords.contains(HashedWord(word));
 }
 
 // Thread: Main.
 void HunspellService::addWord(const QString &word) {
-	const auto count = ranges::accumulate(
-		ranges::views::values(_addedWords),
-		0,
-		ranges::plus(),
-		&std::vector<QString>::size);
-	if (count > kMaxSyncableDictionaryWords) {
+	if (_addedWords.size() > kMaxSyncableDictionaryWords) {
 		return;
 	}
-	_customDict->add(word.toStdString());
-	addedWords(word).push_back(word);
-	writeToFile();
+	{
+		std::lock_guard lock(_customDictMutex);
+		_customDict->add(word.toStdString());
+	}
+	_addedWords.add(word);
+	_verdicts.invalidate();
+	_suggestions.invalidate();
+	appendToJournal(::Spellchecker::kJournalAdded, word);
 }
 
 // Thread: Main.
 void HunspellService::removeWord(const QString &word) {
-	_customDict->remove(word.toStdString());
-	auto &vector = addedWords(word);
-	vector.erase(ranges::remove(vector, word), end(vector));
-	writeToFile();
+	{
+		std::lock_guard lock(_customDictMutex);
+		_customDict->remove(word.toStdString());
+	}
+	_addedWords.remove(word);
+	_verdicts.invalidate();
+	_suggestions.invalidate();
+	appendToJournal(::Spellchecker::kJournalRemoved, word);
 }
 
 // Thread: Main.
-void HunspellService::writeToFile() {
-	auto f = QFile(CustomDictionaryPath());
-	if (!f.open(QIODevice::WriteOnly)) {
+void HunspellService::appendToJournal(char operation, const QString &word) {
+	if (++_journalRecords > kMaxJournalRecords) {
+		compactJournal();
 		return;
 	}
-	auto &&temp = ranges::views::join(
-		ranges::views::values(_addedWords)
-	) | ranges::views::transform([&](auto &str) {
-		return str + kLineBreak;
+	_fileQueue.async([record = operation + word.toUtf8() + kLineBreak] {
+		auto f = QFile(CustomDictionaryJournalPath());
+		if (f.open(QIODevice::WriteOnly | QIODevice::Append)) {
+			f.write(record);
+		}
+	});
+}
+
+// Thread: Main.
+void HunspellService::compactJournal() {
+	_journalRecords = 0;
+	_fileQueue.async([words = _addedWords.words()]() mutable {
+		ranges::sort(words);
+		auto result = QByteArray();
+		for (const auto &word : words) {
+			result.append(word.toUtf8()).append(kLineBreak);
+		}
+		auto f = QSaveFile(CustomDictionaryPath());
+		if (f.open(QIODevice::WriteOnly)) {
+			f.write(result);
+			if (f.commit()) {
+				QFile::remove(CustomDictionaryJournalPath());
+			}
+		}
 	});
-	const auto result = ranges::accumulate(std::move(temp), QString{});
-	f.write(result.toUtf8());
-	f.close();
 }
 
 // Thread: Main.
 void HunspellService::readFile() {
 	using namespace ::Spellchecker;
 
-	auto f = QFile(CustomDictionaryPath());
-
-	if (const auto info = QFileInfo(f);
-		!info.isFile()
-		|| (info.size() > 100 * 1024)
-		|| !f.open(QIODevice::ReadOnly)) {
-		if (info.isDir()) {
-			QDir(info.path()).removeRecursively();
-		}
-		return;
-	}
-	const auto data = f.readAll();
-	f.close();
-	if (data.isEmpty()) {
+	const auto dictionary = ReadSmallFile(
+		CustomDictionaryPath(),
+		kMaxCustomDictionarySize);
+	// The journal is applied whatever its size,
+	// otherwise the compaction would lose all the changes it has.
+	const auto journal = ReadSmallFile(
+		CustomDictionaryJournalPath(),
+		std::numeric_limits<int64>::max());
+	if (dictionary.isEmpty() && journal.isEmpty()) {
 		return;
 	}
 
-	// {"a", "1", "β"};
-	auto splitedWords = QString::fromUtf8(data).split(kLineBreak)
-		| ranges::to_vector
-		| ranges::actions::sort
-		| ranges::actions::unique;
-
-	auto filteredWords = (
-		splitedWords
-	) | ranges::views::filter([](auto &word) {
+	// The words are applied in the order they were written.
+	auto words = std::unordered_set<QString, QStringHash>();
+	for (const auto &word : QString::fromUtf8(dictionary).split(kLineBreak)) {
+		words.emplace(word);
+	}
+	const auto replay = ApplyJournal(words, journal);
+	_journalRecords = (replay.broken || journal.size() > kMaxJournalSize)
+		? (kMaxJournalRecords + 1)
+		: replay.records;
+
+	auto filteredWords = ranges::views::all(
+		words
+	) | ranges::views::filter([](const QString &word) {
 		// Ignore words with mixed scripts or non-words characters.
 		return !word.isEmpty() && !IsWordSkippable(word, false);
-	}) | ranges::views::take(
-		kMaxSyncableDictionaryWords
-	) | ranges::views::transform([](auto &word) {
-		return std::move(word);
-	}) | ranges::to_vector;
-
-	ranges::for_each(filteredWords, [&](auto &word) {
-		_customDict->add(word.toStdString());
-	});
-
-	// {{"a"}, {"β"}};
-	auto groupedWords = ranges::views::all(
-		filteredWords
-	) | ranges::views::chunk_by([](auto &a, auto &b) {
-		return WordScript(a) == WordScript(b);
-	}) | ranges::views::transform([](auto &&rng) {
-		return rng | ranges::to_vector;
-	}) | ranges::to_vector;
-
-	// {QChar::Script_Latin, QChar::Script_Greek};
-	auto scripts = ranges::views::all(
-		groupedWords
-	) | ranges::views::transform([](auto &vector) {
-		return WordScript(vector.front());
 	}) | ranges::to_vector;
+	if (int(filteredWords.size()) > kMaxSyncableDictionaryWords) {
+		// Keep the same words as the sorted file had.
+		ranges::sort(filteredWords);
+		filteredWords.resize(kMaxSyncableDictionaryWords);
+	}
 
-	// {QChar::Script_Latin : {"a"}, QChar::Script_Greek : {"β"}};
-	auto &&zip = ranges::views::zip(
-		scripts, groupedWords
-	);
-	_addedWords = zip | ranges::to<WordsMap>();
+	{
+		std::lock_guard lock(_customDictMutex);
+		ranges::for_each(filteredWords, [&](const QString &word) {
+			_customDict->add(word.toStdString());
+		});
+	}
+	_addedWords.assign(std::move(filteredWords));
 
+	if (_journalRecords > kMaxJournalRecords) {
+		compactJournal();
+	}
 }
 
 ////// End of HunspellService class.
@@ -588,12 +1254,24 @@ bool CheckSpelling(const QString &wordToCheck) {
 	return SharedSpellChecker().checkSpelling(wordToCheck);
 }
 
+std::vector<bool> CheckSpellingWords(const std::vector<QStringView> &words) {
+	return SharedSpellChecker().checkSpellingWords(words);
+}
+
 void FillSuggestionList(
 	const QString &wrongWord,
 	std::vector<QString> *optionalSuggestions) {
 	SharedSpellChecker().fillSuggestionList(wrongWord, optionalSuggestions);
 }
 
+void FillSuggestionListByParts(
+		const QString &wrongWord,
+		Fn<bool(std::vector<QString> &&part)> callback) {
+	SharedSpellChecker().fillSuggestionListByParts(
+		wrongWord,
+		std::move(callback));
+}
+
 void AddWord(const QString &word) {
 	SharedSpellChecker().addWord(word);
 }
@@ -626,15 +1304,36 @@ std::vector<QString> ActiveLanguages() {
 	return SharedSpellChecker().activeLanguages();
 }
 
+std::vector<QString> PendingLanguages() {
+	return SharedSpellChecker().pendingLanguages();
+}
+
 void CheckSpellingText(
 	const QString &text,
 	MisspelledWords *misspelledWords) {
-	*misspelledWords = ::Spellchecker::RangesFromText(
+	*misspelledWords = ::Spellchecker::CheckSkipAndSpellWords(
 		text,
-		[](const QString &word) {
-			return !::Spellchecker::IsWordSkippable(word)
-				&& CheckSpelling(word);
-		});
+		CheckSpellingWords);
+}
+
+void SetParallelChecking(bool enabled) {
+	SharedSpellChecker().setParallelChecking(enabled);
+}
+
+void SetIdleUnloadTimeout(crl::time timeout) {
+	SharedSpellChecker().setIdleUnloadTimeout(timeout);
+}
+
+EnginesUsage EnginesDictionaryUsage() {
+	return SharedSpellChecker().usage();
+}
+
+void PrefetchSuggestions(std::vector<QString> words) {
+	SharedSpellChecker().prefetchSuggestions(std::move(words));
+}
+
+void SetSuggestionsPrefetch(bool enabled) {
+	SharedSpellChecker().setSuggestionsPrefetch(enabled);
 }
 
 } // namespace Platform::Spellchecker::ThirdParty
@@ -11,12 +11,22 @@
 namespace Platform::Spellchecker::ThirdParty {
 
 [[nodiscard]] bool CheckSpelling(const QString &wordToCheck);
+[[nodiscard]] std::vector<bool> CheckSpellingWords(
+	const std::vector<QStringView> &words);
 [[nodiscard]] bool IsWordInDictionary(const QString &wordToCheck);
 
+// The languages with loaded dictionaries.
 std::vector<QString> ActiveLanguages();
+// The enabled languages which dictionaries are not loaded yet,
+// the words of their scripts are considered correct until then.
+std::vector<QString> PendingLanguages();
 void FillSuggestionList(
 	const QString &wrongWord,
 	std::vector<QString> *optionalSuggestions);
+void FillSuggestionListByParts(
+	const QString &wrongWord,
+	Fn<bool(std::vector<QString> &&part)> callback);
+void PrefetchSuggestions(std::vector<QString> words);
 
 void AddWord(const QString &word);
 void RemoveWord(const QString &word);
@@ -28,4 +38,26 @@ void CheckSpellingText(
 
 void UpdateLanguages(std::vector<int> languages);
 
+// When enabled, words of a text are checked by all engines at once,
+// each engine on its own worker of the crl pool.
+void SetParallelChecking(bool enabled);
+
+// The dictionaries are loaded when a word of their script is checked,
+// and unloaded when they are not used for the timeout, zero disables it.
+void SetIdleUnloadTimeout(crl::time timeout);
+
+// When enabled, the suggestions of the words that were found misspelled
+// are computed in background and cached before they are asked for.
+void SetSuggestionsPrefetch(bool enabled);
+
+struct EnginesUsage {
+	int engines = 0;
+	int released = 0;
+
+	// The sizes of the .aff and .dic files of the engines.
+	// The heap that a loaded Hunspell takes is not measured, it is larger.
+	int64 dictionaryFileBytes = 0;
+};
+[[nodiscard]] EnginesUsage EnginesDictionaryUsage();
+
 } // namespace Platform::Spellchecker::ThirdParty
@@ -9,17 +9,40 @@
 #include "nnet_language_identifier.h"
 
 namespace Platform::Language {
+namespace {
 
-LanguageId Recognize(QStringView text) {
-	using chrome_lang_id::NNetLanguageIdentifier;
+using chrome_lang_id::NNetLanguageIdentifier;
 
-	constexpr auto kMinNumBytes = 0;
-	constexpr auto kMaxNumBytes = 1000;
-	constexpr auto kMaxLangs = 3;
+constexpr auto kMinNumBytes = 0;
+constexpr auto kMaxNumBytes = 1000;
+constexpr auto kMaxLangs = 3;
 
-	auto lang_id = NNetLanguageIdentifier(kMinNumBytes, kMaxNumBytes);
-	const auto string = text.toUtf8().toStdString();
-	const auto results = lang_id.FindTopNMostFreqLangs(string, kMaxLangs);
+// The identifier loads its model in the constructor,
+// so each thread creates it once and reuses it for all the texts.
+[[nodiscard]] NNetLanguageIdentifier &Identifier() {
+	thread_local auto result = NNetLanguageIdentifier(
+		kMinNumBytes,
+		kMaxNumBytes);
+	return result;
+}
+
+// The identifier looks only at the first kMaxNumBytes of the text.
+// Each UTF-16 code unit takes at least one byte in UTF-8,
+// so the text is truncated to the same count of code units.
+[[nodiscard]] QStringView Truncated(QStringView text) {
+	if (text.size() <= kMaxNumBytes) {
+		return text;
+	}
+	const auto result = text.left(kMaxNumBytes);
+	return result.back().isHighSurrogate() ? result.chopped(1) : result;
+}
+
+[[nodiscard]] LanguageId RecognizeWith(
+		NNetLanguageIdentifier &identifier,
+		QStringView text) {
+	const auto utf8 = Truncated(text).toUtf8();
+	const auto string = std::string(utf8.constData(), utf8.size());
+	const auto results = identifier.FindTopNMostFreqLangs(string, kMaxLangs);
 
 	auto maxRatio = 0.;
 	auto final = NNetLanguageIdentifier::Result();
@@ -36,4 +59,20 @@ LanguageId Recognize(QStringView text) {
 	return { QLocale(QString::fromStdString(final.language)).language() };
 }
 
+} // namespace
+
+LanguageId Recognize(QStringView text) {
+	return RecognizeWith(Identifier(), text);
+}
+
+std::vector<LanguageId> Recognize(const std::vector<QStringView> &texts) {
+	auto &identifier = Identifier();
+	auto result = std::vector<LanguageId>();
+	result.reserve(texts.size());
+	for (const auto &text : texts) {
+		result.push_back(RecognizeWith(identifier, text));
+	}
+	return result;
+}
+
 } // namespace Platform::Language
@@ -20,12 +20,26 @@ bool CheckSpelling(const QString &wordToCheck) {
 	return ThirdParty::CheckSpelling(wordToCheck);
 }
 
+std::vector<bool> CheckSpellingWords(const std::vector<QStringView> &words) {
+	return ThirdParty::CheckSpellingWords(words);
+}
+
 void FillSuggestionList(
 		const QString &wrongWord,
 		std::vector<QString> *variants) {
 	ThirdParty::FillSuggestionList(wrongWord, variants);
 }
 
+void FillSuggestionListByParts(
+		const QString &wrongWord,
+		Fn<bool(std::vector<QString> &&part)> callback) {
+	ThirdParty::FillSuggestionListByParts(wrongWord, std::move(callback));
+}
+
+void PrefetchSuggestions(std::vector<QString> words) {
+	ThirdParty::PrefetchSuggestions(std::move(words));
+}
+
 void AddWord(const QString &word) {
 	ThirdParty::AddWord(word);
 }